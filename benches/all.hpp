@@ -0,0 +1,22 @@
+#ifndef BENCHES_ALL_HPP
+#define BENCHES_ALL_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+void bench_fluxcore();
+
+/* Prints one result line in the form "<name>: <ops> ops in <ms> ms (<Mops/s>)"
+ *
+ * @name name of the measurement
+ * @ops number of executed operations
+ * @duration runtime of the measurement
+ */
+inline void report(const std::string& name, std::size_t ops, std::chrono::steady_clock::duration duration) {
+    double ms = std::chrono::duration<double, std::milli>(duration).count();
+    std::cout << name << ": " << ops << " ops in " << ms << " ms (" << (ops / ms / 1000.0) << " Mops/s)" << std::endl;
+}
+
+#endif
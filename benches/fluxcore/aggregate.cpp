@@ -0,0 +1,54 @@
+#include <random>
+#include <vector>
+
+#include "all.hpp"
+#include "../all.hpp"
+
+#include <fluxcore/compute/aggregate.hpp>
+#include <fluxcore/datatypes/int.hpp>
+#include <fluxcore/storage/provider/inmemoryprovider.hpp>
+
+using namespace fluxcore;
+
+static const std::size_t nRows = 20000000;
+
+static void fillColumn(Column& column, bool compressible) {
+    std::vector<int_t> values(Column::chunkRows);
+    std::mt19937_64 rng(42);
+    auto t = column.getType();
+
+    for (std::size_t row = 0; row < nRows; row += values.size()) {
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            values[i] = compressible ? static_cast<int_t>(rng() % 1000) : static_cast<int_t>(rng());
+        }
+        column.add(t->createPtr(static_cast<const void*>(values.data())), t->createPtr(static_cast<const void*>(values.data() + values.size())));
+    }
+}
+
+void bench_aggregate() {
+    provider_t provider = std::make_shared<InmemoryProvider>();
+    Column raw(std::make_shared<Int>(), provider);
+    Column encoded(std::make_shared<Int>(), provider);
+    fillColumn(raw, false);
+    fillColumn(encoded, true);
+
+    auto start = std::chrono::steady_clock::now();
+    Aggregate<int_t> result = aggregate<Int>(raw);
+    report("aggregate raw Int", result.count, std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    result = aggregate<Int>(encoded);
+    report("aggregate bit-packed Int", result.count, std::chrono::steady_clock::now() - start);
+
+    // baseline: element-wise access through the type system
+    std::size_t nBaseline = nRows / 20;
+    std::vector<int_t> values(nBaseline, 1);
+    auto t = raw.getType();
+    start = std::chrono::steady_clock::now();
+    int_t sum = 0;
+    dataptrconst_t end = t->createPtr(static_cast<const void*>(values.data() + values.size()));
+    for (dataptrconst_t p = t->createPtr(static_cast<const void*>(values.data())); (*end - *p) > 0; p = *p + 1) {
+        sum += *static_cast<const int_t*>(p->get());
+    }
+    report("sum via DataPtr", static_cast<std::size_t>(sum), std::chrono::steady_clock::now() - start);
+}
@@ -0,0 +1,11 @@
+#include "all.hpp"
+#include "../all.hpp"
+
+void bench_fluxcore() {
+    bench_aggregate();
+    bench_concurrentindex();
+    bench_filter();
+    bench_parallel();
+    bench_provider();
+    bench_table();
+}
@@ -0,0 +1,11 @@
+#ifndef BENCHES_FLUXCORE_ALL_HPP
+#define BENCHES_FLUXCORE_ALL_HPP
+
+void bench_aggregate();
+void bench_concurrentindex();
+void bench_filter();
+void bench_parallel();
+void bench_provider();
+void bench_table();
+
+#endif
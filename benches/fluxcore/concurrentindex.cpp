@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "all.hpp"
+#include "../all.hpp"
+
+#include <fluxcore/storage/provider/inmemoryprovider.hpp>
+#include <fluxcore/storage/concurrentindex.hpp>
+#include <fluxcore/storage/index.hpp>
+
+using namespace fluxcore;
+
+static const std::size_t nKeys = 1000000;
+
+/* Runs <worker(threadId, nThreads)> on <nThreads> threads and reports the overall throughput
+ */
+template <typename F>
+static void runThreads(const std::string& name, std::size_t nThreads, std::size_t ops, F worker) {
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t t = 0; t < nThreads; ++t) {
+        threads.emplace_back(worker, t, nThreads);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    report(name + " (" + std::to_string(nThreads) + " threads)", ops, std::chrono::steady_clock::now() - start);
+}
+
+static std::vector<std::size_t> shuffledKeys() {
+    std::vector<std::size_t> keys(nKeys);
+    for (std::size_t i = 0; i < nKeys; ++i) {
+        keys[i] = i;
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(42));
+
+    return keys;
+}
+
+static void benchOLC(const std::vector<std::size_t>& keys, std::size_t nThreads) {
+    provider_t provider = std::make_shared<InmemoryProvider>();
+    ConcurrentIndex<std::size_t> index(provider);
+
+    runThreads("ConcurrentIndex insert", nThreads, nKeys, [&](std::size_t t, std::size_t n){
+        for (std::size_t i = t; i < nKeys; i += n) {
+            index.insert(keys[i], i);
+        }
+    });
+
+    runThreads("ConcurrentIndex lookup", nThreads, nKeys, [&](std::size_t t, std::size_t n){
+        std::size_t record;
+        for (std::size_t i = t; i < nKeys; i += n) {
+            index.lookup(keys[i], record);
+        }
+    });
+
+    // 90% lookups, 10% inserts into a second key range
+    runThreads("ConcurrentIndex mixed 90/10", nThreads, nKeys, [&](std::size_t t, std::size_t n){
+        std::size_t record;
+        for (std::size_t i = t; i < nKeys; i += n) {
+            if (i % 10 == 0) {
+                index.insert(nKeys + keys[i], i);
+            } else {
+                index.lookup(keys[i], record);
+            }
+        }
+    });
+}
+
+static void benchMutex(const std::vector<std::size_t>& keys, std::size_t nThreads) {
+    provider_t provider = std::make_shared<InmemoryProvider>();
+    SizedIndex<std::size_t, 1024> index(provider);
+    std::mutex mutex;
+
+    runThreads("Index+mutex insert", nThreads, nKeys, [&](std::size_t t, std::size_t n){
+        for (std::size_t i = t; i < nKeys; i += n) {
+            std::lock_guard<std::mutex> lock(mutex);
+            index.insert(keys[i], i);
+        }
+    });
+
+    runThreads("Index+mutex lookup", nThreads, nKeys, [&](std::size_t t, std::size_t n){
+        for (std::size_t i = t; i < nKeys; i += n) {
+            std::lock_guard<std::mutex> lock(mutex);
+            index.find(keys[i]);
+        }
+    });
+
+    runThreads("Index+mutex mixed 90/10", nThreads, nKeys, [&](std::size_t t, std::size_t n){
+        for (std::size_t i = t; i < nKeys; i += n) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (i % 10 == 0) {
+                index.insert(nKeys + keys[i], i);
+            } else {
+                index.find(keys[i]);
+            }
+        }
+    });
+}
+
+void bench_concurrentindex() {
+    std::vector<std::size_t> keys = shuffledKeys();
+    std::size_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+
+    for (std::size_t nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+        benchOLC(keys, nThreads);
+        benchMutex(keys, nThreads);
+    }
+}
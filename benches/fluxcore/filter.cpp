@@ -0,0 +1,79 @@
+#include <random>
+#include <vector>
+
+#include "all.hpp"
+#include "../all.hpp"
+
+#include <fluxcore/compute/filter.hpp>
+#include <fluxcore/datatypes/int.hpp>
+#include <fluxcore/storage/provider/inmemoryprovider.hpp>
+
+using namespace fluxcore;
+
+static const std::size_t nRows = 20000000;
+
+void bench_filter() {
+    provider_t provider = std::make_shared<InmemoryProvider>();
+    Column column(std::make_shared<Int>(), provider);
+    std::vector<int_t> values(Column::chunkRows);
+    std::mt19937_64 rng(42);
+    auto t = column.getType();
+    for (std::size_t row = 0; row < nRows; row += values.size()) {
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            values[i] = static_cast<int_t>(rng() % 1000000);
+        }
+        column.add(t->createPtr(static_cast<const void*>(values.data())), t->createPtr(static_cast<const void*>(values.data() + values.size())));
+    }
+    column.flush();
+
+    auto start = std::chrono::steady_clock::now();
+    Bitmap a = filter<Int>(column, Predicate<int_t>::less(500000));
+    report("filter v < c", column.size(), std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    Bitmap b = filter<Int>(column, Predicate<int_t>::between(250000, 750000));
+    report("filter BETWEEN", column.size(), std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    Bitmap c = filter<Int>(column, Predicate<int_t>::in({1, 10, 100, 1000, 10000, 100000}));
+    report("filter IN (6 values)", column.size(), std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    a &= b;
+    a |= c;
+    report("bitmap AND/OR", 2 * column.size(), std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    Selection selection = a.toSelection();
+    report("bitmap to selection", column.size(), std::chrono::steady_clock::now() - start);
+
+    // time-ordered data, the zone maps restrict the range query to a few segments
+    Column timestamps(std::make_shared<Int>(), provider);
+    int_t now = 1500000000;
+    for (std::size_t row = 0; row < nRows; row += values.size()) {
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            now += static_cast<int_t>(rng() % 4);
+            values[i] = now;
+        }
+        timestamps.add(t->createPtr(static_cast<const void*>(values.data())), t->createPtr(static_cast<const void*>(values.data() + values.size())));
+    }
+    timestamps.flush();
+
+    start = std::chrono::steady_clock::now();
+    Bitmap recent = filter<Int>(timestamps, Predicate<int_t>::greaterEqual(now - 100000));
+    report("filter time range (zone maps)", timestamps.size(), std::chrono::steady_clock::now() - start);
+
+    // baseline: element-wise comparison through the type system
+    std::size_t nBaseline = nRows / 20;
+    int_t threshold = 500000;
+    dataptr_t bound = t->createPtr(static_cast<void*>(&threshold));
+    Selection baseline;
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < nBaseline; ++i) {
+        dataptr_t p = t->createPtr(static_cast<void*>(&values[i % values.size()]));
+        if (*(**p) < *(**bound)) {
+            baseline.push_back(i);
+        }
+    }
+    report("compare via DataRef", nBaseline, std::chrono::steady_clock::now() - start);
+}
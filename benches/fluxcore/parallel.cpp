@@ -0,0 +1,43 @@
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "all.hpp"
+#include "../all.hpp"
+
+#include <fluxcore/compute/parallel.hpp>
+#include <fluxcore/datatypes/int.hpp>
+#include <fluxcore/storage/provider/inmemoryprovider.hpp>
+
+using namespace fluxcore;
+
+static const std::size_t nRows = 50000000;
+
+void bench_parallel() {
+    provider_t provider = std::make_shared<InmemoryProvider>();
+    Column column(std::make_shared<Int>(), provider);
+    std::vector<int_t> values(Column::chunkRows);
+    std::mt19937_64 rng(42);
+    auto t = column.getType();
+    for (std::size_t row = 0; row < nRows; row += values.size()) {
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            values[i] = static_cast<int_t>(rng());
+        }
+        column.add(t->createPtr(static_cast<const void*>(values.data())), t->createPtr(static_cast<const void*>(values.data() + values.size())));
+    }
+    column.flush();
+
+    std::size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+        ThreadPool pool(nThreads);
+        std::string suffix = " (" + std::to_string(nThreads) + " threads)";
+
+        auto start = std::chrono::steady_clock::now();
+        Aggregate<int_t> result = parallelAggregate<Int>(column, pool);
+        report("parallel aggregate" + suffix, result.count, std::chrono::steady_clock::now() - start);
+
+        start = std::chrono::steady_clock::now();
+        Bitmap bitmap = parallelFilter<Int>(column, Predicate<int_t>::less(0), pool);
+        report("parallel filter" + suffix, bitmap.size(), std::chrono::steady_clock::now() - start);
+    }
+}
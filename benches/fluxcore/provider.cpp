@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "all.hpp"
+#include "../all.hpp"
+
+#include <fluxcore/datatypes/int.hpp>
+#include <fluxcore/storage/column.hpp>
+#include <fluxcore/storage/index.hpp>
+#include <fluxcore/storage/provider/bufferpoolprovider.hpp>
+#include <fluxcore/storage/provider/inmemoryprovider.hpp>
+#include <fluxcore/storage/provider/shardedprovider.hpp>
+#include <fluxcore/storage/provider/slabprovider.hpp>
+#include <fluxcore/storage/provider/synchronizedprovider.hpp>
+
+using namespace fluxcore;
+
+static const std::size_t nSegments = 1000000;
+static const std::size_t nKeys = 1000000;
+static const std::size_t nLookups = 10000000;
+static const std::size_t nThreadOps = 1000000;
+static const std::size_t lookupsPerCreate = 8;
+static const std::size_t nColumnRows = 32 * 1024 * 1024;
+
+// keeps the compiler from dropping the lookups
+static volatile std::size_t sink;
+
+static void benchProvider(const char* name, const provider_t& provider) {
+    std::vector<std::size_t> ids(nSegments);
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < nSegments; ++i) {
+        ids[i] = provider->createSegment(64 + (i % 4) * 64).id();
+    }
+    for (std::size_t i = 0; i < nSegments; i += 2) {
+        provider->freeSegment(ids[i]);
+    }
+    for (std::size_t i = 0; i < nSegments; i += 2) {
+        ids[i] = provider->createSegment(64 + (i % 4) * 64).id();
+    }
+    report(std::string(name) + " small segment churn", 2 * nSegments, std::chrono::steady_clock::now() - start);
+
+    // random order defeats the prefetcher, like the node visits of an index
+    std::size_t found = 0;
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < nLookups; ++i) {
+        found += provider->getSegment(ids[(i * 7919) % nSegments]).size();
+    }
+    report(std::string(name) + " random lookups", nLookups, std::chrono::steady_clock::now() - start);
+    sink = found;
+
+    for (std::size_t id : ids) {
+        provider->freeSegment(id);
+    }
+
+    Index<std::size_t, 16> index(provider);
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < nKeys; ++i) {
+        index.insert((i * 7919) % nKeys, i);
+    }
+    report(std::string(name) + " index inserts", nKeys, std::chrono::steady_clock::now() - start);
+}
+
+// every thread creates, looks up and frees segments of its own, with a lookup heavy mix like an index
+static void benchContention(const char* name, const provider_t& provider, std::size_t nThreads) {
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t t = 0; t < nThreads; ++t) {
+        threads.emplace_back([&provider, nThreads]() {
+            std::vector<std::size_t> ids;
+            std::size_t found = 0;
+            for (std::size_t i = 0; i < nThreadOps / nThreads; ++i) {
+                if (i % lookupsPerCreate == 0) {
+                    ids.push_back(provider->createSegment(128).id());
+                    if (ids.size() > 1024) {
+                        provider->freeSegment(ids[ids.size() - 1025]);
+                        ids[ids.size() - 1025] = ids.back();
+                        ids.pop_back();
+                    }
+                } else {
+                    found += provider->getSegment(ids[(i * 7919) % ids.size()]).size();
+                }
+            }
+            for (std::size_t id : ids) {
+                provider->freeSegment(id);
+            }
+            sink = found;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::string label = std::string(name) + " with " + std::to_string(nThreads) + " threads";
+    report(label, nThreadOps / nThreads * nThreads, std::chrono::steady_clock::now() - start);
+}
+
+static void benchColdScan(const char* name, const provider_t& provider) {
+    Column column(std::make_shared<Int>(), provider);
+    std::vector<int_t> data(Column::chunkRows);
+    for (std::size_t done = 0; done < nColumnRows; done += data.size()) {
+        for (std::size_t r = 0; r < data.size(); ++r) {
+            data[r] = static_cast<int_t>(((done + r) * 0x9e3779b97f4a7c15ull) ^ (r >> 3));
+        }
+        column.add(column.getType()->createPtr(static_cast<const void*>(data.data())), column.getType()->createPtr(static_cast<const void*>(data.data() + data.size())));
+    }
+
+    // the second scan runs over segments that were evicted by the first one
+    for (std::size_t round = 0; round < 2; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        Column::Cursor cursor = column.scan();
+        Column::Span span;
+        int_t sum = 0;
+        while (cursor.next(span)) {
+            const int_t* values = static_cast<const int_t*>(span.data);
+            for (std::size_t i = 0; i < span.rowCount; ++i) {
+                sum += values[i];
+            }
+        }
+        report(std::string(name) + " column scan", nColumnRows, std::chrono::steady_clock::now() - start);
+        sink = static_cast<std::size_t>(sum);
+    }
+}
+
+void bench_provider() {
+    benchProvider("InmemoryProvider", std::make_shared<InmemoryProvider>());
+    benchProvider("SlabProvider", std::make_shared<SlabProvider>(std::make_shared<InmemoryProvider>()));
+
+    benchColdScan("InmemoryProvider", std::make_shared<InmemoryProvider>());
+    benchColdScan("BufferPoolProvider (budget 1/4)", std::make_shared<BufferPoolProvider>("/tmp/fluxbench-spill", nColumnRows * sizeof(int_t) / 4));
+
+    std::size_t maxThreads = std::max(4u, std::thread::hardware_concurrency());
+    for (std::size_t nThreads = 1; nThreads <= maxThreads; nThreads *= 2) {
+        benchContention("SynchronizedProvider", std::make_shared<SynchronizedProvider>(std::make_shared<InmemoryProvider>()), nThreads);
+        benchContention("ShardedProvider", std::make_shared<ShardedProvider>(nThreads), nThreads);
+    }
+}
@@ -0,0 +1,54 @@
+#include <vector>
+
+#include "all.hpp"
+#include "../all.hpp"
+
+#include <fluxcore/datatypes/byte.hpp>
+#include <fluxcore/datatypes/float.hpp>
+#include <fluxcore/datatypes/int.hpp>
+#include <fluxcore/storage/provider/inmemoryprovider.hpp>
+#include <fluxcore/storage/table.hpp>
+
+using namespace fluxcore;
+
+static const std::size_t nRows = 10000000;
+static const std::size_t batchRows = 65536;
+
+// keeps the compiler from dropping the scan
+static volatile int_t sink;
+
+void bench_table() {
+    provider_t provider = std::make_shared<InmemoryProvider>();
+    Table table({std::make_shared<Int>(), std::make_shared<Int>(), std::make_shared<Float>(), std::make_shared<Byte>()}, provider);
+    typeptr_t rowType = table.getRowType();
+    std::size_t rowSize = rowType->getSize();
+
+    std::vector<char> rows(batchRows * rowSize);
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        rows[i] = static_cast<char>(i * 31);
+    }
+    dataptrconst_t begin = rowType->createPtr(static_cast<const void*>(rows.data()));
+    dataptrconst_t end = rowType->createPtr(static_cast<const void*>(rows.data() + rows.size()));
+
+    std::size_t ingested = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (; ingested < nRows; ingested += batchRows) {
+        table.addRows(begin, end);
+    }
+    report("table addRows", ingested, std::chrono::steady_clock::now() - start);
+
+    start = std::chrono::steady_clock::now();
+    Table::Cursor cursor = table.scan({0, 2, 3});
+    Table::Batch batch;
+    std::size_t scanned = 0;
+    int_t sum = 0;
+    while (cursor.next(batch)) {
+        const int_t* values = static_cast<const int_t*>(batch.data[0]);
+        for (std::size_t i = 0; i < batch.rowCount; ++i) {
+            sum += values[i];
+        }
+        scanned += batch.rowCount;
+    }
+    report("table scan of 3 columns", scanned, std::chrono::steady_clock::now() - start);
+    sink = sum;
+}
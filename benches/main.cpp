@@ -0,0 +1,11 @@
+#include "all.hpp"
+
+#include <fluxcore/init.hpp>
+
+int main() {
+    fluxcore::init();
+
+    bench_fluxcore();
+
+    return 0;
+}
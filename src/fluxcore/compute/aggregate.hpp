@@ -0,0 +1,130 @@
+#ifndef FLUXCORE_AGGREGATE_HPP
+#define FLUXCORE_AGGREGATE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include "../storage/column.hpp"
+
+namespace fluxcore {
+
+/* Result of an aggregation over values of type <T>
+ *
+ * Integral values are summed up as 64 bit integers that wrap around on overflow, floating point values as doubles.
+ * <min> and <max> are only meaningful if <count> is not 0.
+ */
+template <typename T>
+struct Aggregate {
+    typedef typename std::conditional<std::is_integral<T>::value,
+            typename std::conditional<std::is_signed<T>::value, std::int64_t, std::uint64_t>::type,
+            double>::type sum_t;
+
+    // sums get computed unsigned, so the wrap around is well defined
+    typedef typename std::conditional<std::is_integral<T>::value, std::uint64_t, double>::type acc_t;
+
+    std::size_t count;
+    sum_t sum;
+    T min;
+    T max;
+
+    Aggregate() : count(0), sum(0), min(std::numeric_limits<T>::max()), max(std::numeric_limits<T>::lowest()) {}
+
+    /* Returns the average of all values or NaN if there are none
+     */
+    double avg() const {
+        if (count == 0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        return static_cast<double>(sum) / static_cast<double>(count);
+    }
+
+    /* Merges the result of another part of the data
+     */
+    void merge(const Aggregate& other) {
+        count += other.count;
+        sum = static_cast<sum_t>(static_cast<acc_t>(sum) + static_cast<acc_t>(other.sum));
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+};
+
+/* Aggregates a contiguous array of values into <acc>
+ *
+ * @data the values
+ * @n number of values
+ * @acc receives the aggregates
+ *
+ * The values get distributed over <lanes> independent accumulators, which removes the dependency between
+ * subsequent iterations. This way the compiler turns the inner loop into SIMD instructions.
+ */
+template <typename T>
+void aggregateSpan(const T* data, std::size_t n, Aggregate<T>& acc) {
+    typedef typename Aggregate<T>::acc_t acc_t;
+    static constexpr std::size_t lanes = 8;
+
+    acc_t sums[lanes];
+    T mins[lanes];
+    T maxs[lanes];
+    std::fill(sums, sums + lanes, acc_t(0));
+    std::fill(mins, mins + lanes, acc.min);
+    std::fill(maxs, maxs + lanes, acc.max);
+
+    std::size_t i = 0;
+    for (; i + lanes <= n; i += lanes) {
+        for (std::size_t j = 0; j < lanes; ++j) {
+            T v = data[i + j];
+            sums[j] += static_cast<acc_t>(v);
+            mins[j] = (v < mins[j]) ? v : mins[j];
+            maxs[j] = (v > maxs[j]) ? v : maxs[j];
+        }
+    }
+    for (; i < n; ++i) {
+        T v = data[i];
+        sums[0] += static_cast<acc_t>(v);
+        mins[0] = (v < mins[0]) ? v : mins[0];
+        maxs[0] = (v > maxs[0]) ? v : maxs[0];
+    }
+
+    acc_t sum = static_cast<acc_t>(acc.sum);
+    for (std::size_t j = 0; j < lanes; ++j) {
+        sum += sums[j];
+        acc.min = std::min(acc.min, mins[j]);
+        acc.max = std::max(acc.max, maxs[j]);
+    }
+    acc.sum = static_cast<typename Aggregate<T>::sum_t>(sum);
+    acc.count += n;
+}
+
+/* Computes count, sum, min and max of a column
+ *
+ * @P primitive type of the column, e.g. <Int>, <Float> or <Byte>
+ * @column the column to aggregate
+ *
+ * The kernel gets instantiated for the value type of <P>, so the scan works on plain arrays instead of <DataPtr>
+ * objects. Throws if the column is not of type <P>.
+ */
+template <typename P>
+Aggregate<typename P::type> aggregate(const Column& column) {
+    typedef typename P::type T;
+
+    if (column.getType()->getID() != P::id) {
+        throw std::runtime_error("Type does not match the column!");
+    }
+
+    Aggregate<T> acc;
+    Column::Cursor cursor = column.scan();
+    Column::Span span;
+    while (cursor.next(span)) {
+        aggregateSpan(static_cast<const T*>(span.data), span.rowCount, acc);
+    }
+
+    return acc;
+}
+
+}
+
+#endif
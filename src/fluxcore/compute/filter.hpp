@@ -0,0 +1,441 @@
+#ifndef FLUXCORE_FILTER_HPP
+#define FLUXCORE_FILTER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include "../storage/column.hpp"
+
+namespace fluxcore {
+
+/* Sorted list of qualifying row ids
+ */
+typedef std::vector<std::size_t> Selection;
+
+/* Sets <count> consecutive bits starting at bit <first> of an array of 64 bit words
+ */
+inline void setBits(std::uint64_t* words, std::size_t first, std::size_t count) {
+    std::size_t end = first + count;
+    for (; (first < end) && (first % 64 != 0); ++first) {
+        words[first / 64] |= std::uint64_t(1) << (first % 64);
+    }
+    for (; first + 64 <= end; first += 64) {
+        words[first / 64] = ~std::uint64_t(0);
+    }
+    for (; first < end; ++first) {
+        words[first / 64] |= std::uint64_t(1) << (first % 64);
+    }
+}
+
+/* One bit per row of a column, set bits mark qualifying rows
+ */
+class Bitmap {
+    public:
+        static constexpr std::size_t wordBits = 64;
+
+        Bitmap() : bits(0) {}
+
+        explicit Bitmap(std::size_t size) : bits(size), words((size + wordBits - 1) / wordBits, 0) {}
+
+        std::size_t size() const {
+            return bits;
+        }
+
+        bool test(std::size_t row) const {
+            return (words[row / wordBits] >> (row % wordBits)) & 1;
+        }
+
+        void set(std::size_t row) {
+            words[row / wordBits] |= std::uint64_t(1) << (row % wordBits);
+        }
+
+        /* Sets the bits of <count> rows starting at <first>
+         */
+        void setRange(std::size_t first, std::size_t count) {
+            setBits(words.data(), first, count);
+        }
+
+        /* Returns the number of set bits
+         */
+        std::size_t count() const {
+            std::size_t n = 0;
+            for (std::uint64_t w : words) {
+                n += static_cast<std::size_t>(__builtin_popcountll(w));
+            }
+            return n;
+        }
+
+        /* Intersects this bitmap with <other>, both have to cover the same number of rows
+         */
+        Bitmap& operator&=(const Bitmap& other) {
+            checkSize(other);
+            for (std::size_t i = 0; i < words.size(); ++i) {
+                words[i] &= other.words[i];
+            }
+            return *this;
+        }
+
+        /* Unites this bitmap with <other>, both have to cover the same number of rows
+         */
+        Bitmap& operator|=(const Bitmap& other) {
+            checkSize(other);
+            for (std::size_t i = 0; i < words.size(); ++i) {
+                words[i] |= other.words[i];
+            }
+            return *this;
+        }
+
+        /* Converts the set bits into a selection vector
+         */
+        Selection toSelection() const {
+            Selection result;
+            result.reserve(count());
+            for (std::size_t i = 0; i < words.size(); ++i) {
+                for (std::uint64_t w = words[i]; w != 0; w &= w - 1) {
+                    result.push_back(i * wordBits + static_cast<std::size_t>(__builtin_ctzll(w)));
+                }
+            }
+            return result;
+        }
+
+        /* Raw words, bit <i> of word <j> stands for row <j * wordBits + i>
+         */
+        std::uint64_t* data() {
+            return words.data();
+        }
+
+        const std::uint64_t* data() const {
+            return words.data();
+        }
+
+    private:
+        std::size_t bits;
+        std::vector<std::uint64_t> words;
+
+        void checkSize(const Bitmap& other) const {
+            if (other.bits != bits) {
+                throw std::runtime_error("Bitmaps have different sizes!");
+            }
+        }
+};
+
+inline Bitmap operator&(const Bitmap& a, const Bitmap& b) {
+    Bitmap result(a);
+    result &= b;
+    return result;
+}
+
+inline Bitmap operator|(const Bitmap& a, const Bitmap& b) {
+    Bitmap result(a);
+    result |= b;
+    return result;
+}
+
+/* Intersection of two selection vectors
+ */
+inline Selection operator&(const Selection& a, const Selection& b) {
+    Selection result;
+    result.reserve(std::min(a.size(), b.size()));
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+    return result;
+}
+
+/* Union of two selection vectors
+ */
+inline Selection operator|(const Selection& a, const Selection& b) {
+    Selection result;
+    result.reserve(a.size() + b.size());
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+    return result;
+}
+
+/* Comparison of column values with constants
+ *
+ * Create instances via the static factories. Comparisons follow the semantics of the C++ operators, so NaN never
+ * qualifies.
+ */
+template <typename T>
+struct Predicate {
+    enum class Op {
+        Equal,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Between,    // lo <= v <= hi
+        In          // v is one of <values>
+    };
+
+    Op op;
+    T lo;
+    T hi;
+    std::vector<T> values; // sorted and unique
+
+    Predicate(Op op, T lo, T hi) : op(op), lo(lo), hi(hi) {}
+
+    static Predicate equal(T v) {
+        return Predicate(Op::Equal, v, v);
+    }
+
+    static Predicate less(T v) {
+        return Predicate(Op::Less, v, v);
+    }
+
+    static Predicate lessEqual(T v) {
+        return Predicate(Op::LessEqual, v, v);
+    }
+
+    static Predicate greater(T v) {
+        return Predicate(Op::Greater, v, v);
+    }
+
+    static Predicate greaterEqual(T v) {
+        return Predicate(Op::GreaterEqual, v, v);
+    }
+
+    static Predicate between(T lo, T hi) {
+        return Predicate(Op::Between, lo, hi);
+    }
+
+    static Predicate in(std::vector<T> values) {
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+
+        Predicate p(Op::In, T(), T());
+        p.values = std::move(values);
+        return p;
+    }
+
+    /* Returns <false> if no value in [<min>, <max>] qualifies
+     */
+    bool mayMatch(T min, T max) const {
+        switch (op) {
+            case Op::Equal:
+                return (min <= lo) && (lo <= max);
+            case Op::Less:
+                return min < lo;
+            case Op::LessEqual:
+                return min <= lo;
+            case Op::Greater:
+                return max > lo;
+            case Op::GreaterEqual:
+                return max >= lo;
+            case Op::Between:
+                return (lo <= hi) && (min <= hi) && (lo <= max);
+            case Op::In: {
+                typename std::vector<T>::const_iterator it = std::lower_bound(values.begin(), values.end(), min);
+                return (it != values.end()) && (*it <= max);
+            }
+        }
+        return true;
+    }
+
+    /* Returns <true> if every value in [<min>, <max>] qualifies
+     */
+    bool matchesAll(T min, T max) const {
+        switch (op) {
+            case Op::Equal:
+                return (min == lo) && (max == lo);
+            case Op::Less:
+                return max < lo;
+            case Op::LessEqual:
+                return max <= lo;
+            case Op::Greater:
+                return min > lo;
+            case Op::GreaterEqual:
+                return min >= lo;
+            case Op::Between:
+                return (lo <= min) && (max <= hi);
+            case Op::In:
+                return (min == max) && std::binary_search(values.begin(), values.end(), min);
+        }
+        return false;
+    }
+};
+
+/* IN lists up to this size get compared linearly, larger ones get binary searched
+ */
+constexpr std::size_t filterLinearInLimit = 16;
+
+/* Evaluates <cond> for <n> values (at most 64) and packs the results into one word
+ */
+template <typename T, typename Cond>
+inline std::uint64_t filterWord(const T* data, std::size_t n, Cond cond) {
+    std::uint64_t word = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        word |= static_cast<std::uint64_t>(cond(data[i])) << i;
+    }
+    return word;
+}
+
+/* Evaluates <cond> for exactly 64 values and packs the results into one word
+ *
+ * The compares go into a byte array first, a loop the compiler turns into SIMD compares. Multiplying 8 bytes of 0
+ * and 1 with <0x0102040810204080> then gathers their low bits in the top byte of the product (little endian hosts).
+ */
+template <typename T, typename Cond>
+inline std::uint64_t filterFullWord(const T* data, Cond cond) {
+    static constexpr std::size_t wordBits = Bitmap::wordBits;
+    std::uint8_t hits[wordBits];
+    for (std::size_t i = 0; i < wordBits; ++i) {
+        hits[i] = static_cast<std::uint8_t>(cond(data[i]));
+    }
+
+    std::uint64_t word = 0;
+    for (std::size_t i = 0; i < wordBits / 8; ++i) {
+        std::uint64_t bytes;
+        std::memcpy(&bytes, hits + 8 * i, 8);
+        word |= ((bytes * UINT64_C(0x0102040810204080)) >> 56) << (8 * i);
+    }
+    return word;
+}
+
+/* Sets the bits of all qualifying values of a contiguous array
+ *
+ * @data the values
+ * @n number of values
+ * @firstRow row id of the first value, does not have to be word aligned
+ * @words target bitmap words, qualifying bits get ORed in
+ */
+template <typename T, typename Cond>
+void filterSpan(const T* data, std::size_t n, std::size_t firstRow, std::uint64_t* words, Cond cond) {
+    static constexpr std::size_t wordBits = Bitmap::wordBits;
+    std::size_t i = 0;
+
+    // leading values up to the next word boundary
+    std::size_t offset = firstRow % wordBits;
+    if (offset != 0) {
+        std::size_t head = std::min(n, wordBits - offset);
+        words[firstRow / wordBits] |= filterWord(data, head, cond) << offset;
+        i = head;
+    }
+
+    for (; i + wordBits <= n; i += wordBits) {
+        words[(firstRow + i) / wordBits] |= filterFullWord(data + i, cond);
+    }
+
+    if (i < n) {
+        words[(firstRow + i) / wordBits] |= filterWord(data + i, n - i, cond);
+    }
+}
+
+template <typename T>
+void filterSpan(const T* data, std::size_t n, std::size_t firstRow, std::uint64_t* words, const Predicate<T>& p) {
+    typedef typename Predicate<T>::Op Op;
+    const T lo = p.lo;
+    const T hi = p.hi;
+
+    switch (p.op) {
+        case Op::Equal:
+            filterSpan(data, n, firstRow, words, [lo](T v) { return v == lo; });
+            break;
+        case Op::Less:
+            filterSpan(data, n, firstRow, words, [lo](T v) { return v < lo; });
+            break;
+        case Op::LessEqual:
+            filterSpan(data, n, firstRow, words, [lo](T v) { return v <= lo; });
+            break;
+        case Op::Greater:
+            filterSpan(data, n, firstRow, words, [lo](T v) { return v > lo; });
+            break;
+        case Op::GreaterEqual:
+            filterSpan(data, n, firstRow, words, [lo](T v) { return v >= lo; });
+            break;
+        case Op::Between:
+            filterSpan(data, n, firstRow, words, [lo, hi](T v) { return (v >= lo) & (v <= hi); });
+            break;
+        case Op::In: {
+            const T* begin = p.values.data();
+            const T* end = begin + p.values.size();
+            if (p.values.size() <= filterLinearInLimit) {
+                filterSpan(data, n, firstRow, words, [begin, end](T v) {
+                    bool hit = false;
+                    for (const T* it = begin; it != end; ++it) {
+                        hit |= (v == *it);
+                    }
+                    return hit;
+                });
+            } else {
+                filterSpan(data, n, firstRow, words, [begin, end](T v) { return std::binary_search(begin, end, v); });
+            }
+            break;
+        }
+    }
+}
+
+/* Evaluates a predicate for the rows of a single zone of a column
+ *
+ * @column the column to filter
+ * @zone zone of <column>, see <Column::zones>
+ * @predicate the comparison
+ * @words target bitmap words, qualifying bits get ORed in
+ * @baseRow row that is represented by the first bit of <words>, has to be a multiple of 64
+ *
+ * The zone map gets checked first: zones without qualifying values are skipped and zones with only qualifying values
+ * get marked without reading their payload. Otherwise the rows get evaluated span by span, encoded segments get
+ * decoded block-wise.
+ */
+template <typename T>
+void filterZone(const Column& column, const Column::Zone& zone, const Predicate<T>& predicate, std::uint64_t* words, std::size_t baseRow) {
+    if (zone.hasRange) {
+        T min;
+        T max;
+        memcpy(&min, zone.min, sizeof(T));
+        memcpy(&max, zone.max, sizeof(T));
+
+        if (!predicate.mayMatch(min, max)) {
+            return;
+        }
+        if (predicate.matchesAll(min, max)) {
+            setBits(words, zone.firstRow - baseRow, zone.rowCount);
+            return;
+        }
+    }
+
+    // spans never cross segment boundaries
+    Column::Cursor cursor = column.scan(zone.firstRow);
+    Column::Span span;
+    std::size_t nextRow = zone.firstRow;
+    std::size_t lastRow = zone.firstRow + zone.rowCount;
+    while ((nextRow < lastRow) && cursor.next(span)) {
+        filterSpan(static_cast<const T*>(span.data), span.rowCount, span.firstRow - baseRow, words, predicate);
+        nextRow = span.firstRow + span.rowCount;
+    }
+}
+
+/* Evaluates a predicate against a column and returns a bitmap with one bit per row
+ *
+ * @P primitive type of the column, e.g. <Int>, <Float> or <Byte>
+ * @column the column to filter
+ * @predicate the comparison
+ *
+ * Works zone by zone, see <filterZone>. Throws if the column is not of type <P>.
+ */
+template <typename P>
+Bitmap filter(const Column& column, const Predicate<typename P::type>& predicate) {
+    if (column.getType()->getID() != P::id) {
+        throw std::runtime_error("Type does not match the column!");
+    }
+
+    Bitmap result(column.size());
+    for (const Column::Zone& zone : column.zones()) {
+        filterZone(column, zone, predicate, result.data(), 0);
+    }
+
+    return result;
+}
+
+/* Evaluates a predicate against a column and returns the ids of all qualifying rows
+ */
+template <typename P>
+Selection selectRows(const Column& column, const Predicate<typename P::type>& predicate) {
+    return filter<P>(column, predicate).toSelection();
+}
+
+}
+
+#endif
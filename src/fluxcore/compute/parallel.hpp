@@ -0,0 +1,159 @@
+#ifndef FLUXCORE_PARALLEL_HPP
+#define FLUXCORE_PARALLEL_HPP
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "../storage/table.hpp"
+#include "aggregate.hpp"
+#include "filter.hpp"
+#include "threadpool.hpp"
+
+namespace fluxcore {
+
+/* Range of rows that gets processed by a single task
+ */
+struct Morsel {
+    std::size_t firstRow;
+    std::size_t rowCount;
+};
+
+/* Splits a column into morsels along its segment boundaries
+ */
+inline std::vector<Morsel> morsels(const Column& column) {
+    std::vector<Morsel> result;
+    for (const Column::Zone& zone : column.zones()) {
+        result.push_back(Morsel{zone.firstRow, zone.rowCount});
+    }
+    return result;
+}
+
+/* Splits a table into morsels, every morsel lies within a single segment of each column
+ *
+ * Columns that were filled by <Table::addRows> share their segment boundaries, so the morsels are the segments.
+ */
+inline std::vector<Morsel> morsels(const Table& table) {
+    std::vector<std::size_t> bounds;
+    for (std::size_t i = 0; i < table.getColumnCount(); ++i) {
+        for (const Column::Zone& zone : table.getColumn(i)->zones()) {
+            bounds.push_back(zone.firstRow + zone.rowCount);
+        }
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+    std::vector<Morsel> result;
+    std::size_t firstRow = 0;
+    for (std::size_t bound : bounds) {
+        result.push_back(Morsel{firstRow, bound - firstRow});
+        firstRow = bound;
+    }
+    return result;
+}
+
+/* Calls <fn(span)> for all spans of a column that belong to <morsel>
+ */
+template <typename F>
+void scanMorsel(const Column& column, const Morsel& morsel, F fn) {
+    Column::Cursor cursor = column.scan(morsel.firstRow);
+    Column::Span span;
+    std::size_t lastRow = morsel.firstRow + morsel.rowCount;
+
+    while (cursor.next(span) && (span.firstRow < lastRow)) {
+        span.rowCount = std::min(span.rowCount, lastRow - span.firstRow);
+        fn(static_cast<const Column::Span&>(span));
+    }
+}
+
+/* Scans a column with all workers of <pool>
+ *
+ * @column the column to scan
+ * @fn gets called as <fn(span, worker)> for every span, concurrently for spans of different morsels
+ * @pool workers that run the scan
+ *
+ * Every segment forms one morsel. The order of the spans is undefined, but all spans of a morsel are passed in row
+ * order by the same worker.
+ */
+template <typename F>
+void parallelScan(const Column& column, F fn, ThreadPool& pool = ThreadPool::getDefault()) {
+    std::vector<Morsel> parts = morsels(column);
+
+    pool.parallelFor(parts.size(), [&](std::size_t i, std::size_t worker) {
+        scanMorsel(column, parts[i], [&](const Column::Span& span) {
+            fn(span, worker);
+        });
+    });
+}
+
+/* Parallel version of <aggregate>, every worker aggregates into its own partial result
+ */
+template <typename P>
+Aggregate<typename P::type> parallelAggregate(const Column& column, ThreadPool& pool = ThreadPool::getDefault()) {
+    typedef typename P::type T;
+
+    if (column.getType()->getID() != P::id) {
+        throw std::runtime_error("Type does not match the column!");
+    }
+
+    std::vector<Aggregate<T>> partials(pool.size());
+    parallelScan(column, [&partials](const Column::Span& span, std::size_t worker) {
+        aggregateSpan(static_cast<const T*>(span.data), span.rowCount, partials[worker]);
+    }, pool);
+
+    Aggregate<T> result;
+    for (const Aggregate<T>& partial : partials) {
+        result.merge(partial);
+    }
+    return result;
+}
+
+/* Parallel version of <filter>
+ *
+ * Every task owns the bitmap words of its morsel. Words that are shared with a neighbouring morsel get merged after
+ * all tasks finished.
+ */
+template <typename P>
+Bitmap parallelFilter(const Column& column, const Predicate<typename P::type>& predicate, ThreadPool& pool = ThreadPool::getDefault()) {
+    static constexpr std::size_t wordBits = Bitmap::wordBits;
+
+    if (column.getType()->getID() != P::id) {
+        throw std::runtime_error("Type does not match the column!");
+    }
+
+    Bitmap result(column.size());
+    std::vector<Column::Zone> zones = column.zones();
+    std::vector<std::pair<std::size_t, std::uint64_t>> edges(2 * zones.size(), std::make_pair(0, 0));
+
+    pool.parallelFor(zones.size(), [&](std::size_t i, std::size_t) {
+        const Column::Zone& zone = zones[i];
+        std::size_t lastRow = zone.firstRow + zone.rowCount;
+        std::size_t firstWord = zone.firstRow / wordBits;
+        std::size_t endWord = (lastRow + wordBits - 1) / wordBits;
+
+        std::vector<std::uint64_t> words(endWord - firstWord, 0);
+        filterZone(column, zone, predicate, words.data(), firstWord * wordBits);
+
+        std::uint64_t* target = result.data();
+        for (std::size_t w = firstWord; w < endWord; ++w) {
+            std::uint64_t bits = words[w - firstWord];
+            if ((w == firstWord) && (zone.firstRow % wordBits != 0)) {
+                edges[2 * i] = std::make_pair(w, bits);
+            } else if ((w + 1 == endWord) && (lastRow % wordBits != 0)) {
+                edges[2 * i + 1] = std::make_pair(w, bits);
+            } else {
+                target[w] = bits;
+            }
+        }
+    });
+
+    for (const auto& edge : edges) {
+        result.data()[edge.first] |= edge.second;
+    }
+
+    return result;
+}
+
+}
+
+#endif
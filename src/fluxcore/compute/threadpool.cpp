@@ -0,0 +1,165 @@
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <exception>
+
+using namespace fluxcore;
+
+// pool and index of the worker running on the current thread
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local std::size_t currentWorker = 0;
+
+ThreadPool::ThreadPool(std::size_t nThreads) : queued(0), stopping(false) {
+    if (nThreads == 0) {
+        nThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (std::size_t i = 0; i < nThreads; ++i) {
+        queues.emplace_back(new Queue());
+    }
+    for (std::size_t i = 0; i < nThreads; ++i) {
+        threads.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+std::size_t ThreadPool::size() const {
+    return queues.size();
+}
+
+void ThreadPool::parallelFor(std::size_t n, const body_t& body) {
+    if (n == 0) {
+        return;
+    }
+
+    struct Job {
+        std::mutex mutex;
+        std::condition_variable done;
+        std::size_t remaining;
+        std::exception_ptr error;
+    } job;
+    job.remaining = n;
+
+    // the last task notifies while holding the mutex, so <job> stays alive until it is finished
+    auto finish = [&job](std::exception_ptr error) {
+        std::lock_guard<std::mutex> lock(job.mutex);
+        if (error && !job.error) {
+            job.error = error;
+        }
+        if (--job.remaining == 0) {
+            job.done.notify_all();
+        }
+    };
+
+    // contiguous ranges of tasks per worker
+    std::size_t nWorkers = size();
+    for (std::size_t i = 0; i < n; ++i) {
+        push(i * nWorkers / n, [i, &body, &finish](std::size_t worker) {
+            std::exception_ptr error;
+            try {
+                body(i, worker);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            finish(error);
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(job.mutex);
+    if (currentPool == this) {
+        // blocking a worker could dead-lock nested calls, so process tasks until the job is done
+        std::size_t worker = currentWorker;
+        while (job.remaining > 0) {
+            lock.unlock();
+            task_t task;
+            if (take(worker, task)) {
+                task(worker);
+            } else {
+                std::this_thread::yield();
+            }
+            lock.lock();
+        }
+    } else {
+        job.done.wait(lock, [&job]() { return job.remaining == 0; });
+    }
+
+    if (job.error) {
+        std::rethrow_exception(job.error);
+    }
+}
+
+ThreadPool& ThreadPool::getDefault() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::push(std::size_t worker, task_t&& task) {
+    // the counter is raised before the task becomes visible, so it never drops below zero
+    ++queued;
+    {
+        std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+        queues[worker]->tasks.push_back(std::move(task));
+    }
+
+    // sleeping workers check the counter while holding <sleepMutex>, so they cannot miss the notification
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeup.notify_one();
+}
+
+bool ThreadPool::take(std::size_t worker, task_t& task) {
+    std::size_t nWorkers = size();
+
+    for (std::size_t i = 0; i < nWorkers; ++i) {
+        Queue& q = *queues[(worker + i) % nWorkers];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) {
+            continue;
+        }
+
+        // own tasks are taken in order, thieves take them from the other end of the range
+        if (i == 0) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+        } else {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        }
+
+        --queued;
+        return true;
+    }
+
+    return false;
+}
+
+void ThreadPool::run(std::size_t worker) {
+    currentPool = this;
+    currentWorker = worker;
+
+    while (true) {
+        task_t task;
+        if (take(worker, task)) {
+            task(worker);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeup.wait(lock, [this]() { return stopping || (queued > 0); });
+        if (stopping && (queued == 0)) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef FLUXCORE_THREADPOOL_HPP
+#define FLUXCORE_THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fluxcore {
+
+/* Work-stealing thread pool
+ *
+ * Every worker owns a task queue. Workers take tasks from the front of their own queue and steal from the back of
+ * the queues of others once theirs runs dry, so work spreads evenly even when tasks have very different run times.
+ *
+ * Tasks receive the index of the worker that runs them, which allows per-worker partial results without any
+ * synchronization.
+ */
+class ThreadPool {
+    public:
+        /* Task body, gets called with the index of the task and the index of the worker in [0, size())
+         */
+        typedef std::function<void(std::size_t, std::size_t)> body_t;
+
+        /* Starts <nThreads> workers, 0 means one per hardware thread
+         */
+        explicit ThreadPool(std::size_t nThreads = 0);
+        ThreadPool(const ThreadPool&) = delete;
+
+        /* Waits for all queued tasks and stops the workers
+         */
+        ~ThreadPool();
+
+        /* Returns the number of workers
+         */
+        std::size_t size() const;
+
+        /* Runs <body> for all tasks in [0, <n>) and waits until they are finished
+         *
+         * @n number of tasks
+         * @body task body
+         *
+         * Consecutive tasks get queued at the same worker, so neighbouring morsels are processed by the same core until
+         * someone steals them. Workers that call this function (nested parallelism) help processing tasks while they
+         * wait. The first exception thrown by a task gets rethrown after all tasks finished.
+         */
+        void parallelFor(std::size_t n, const body_t& body);
+
+        /* Returns the pool shared by the whole library, it has one worker per hardware thread
+         */
+        static ThreadPool& getDefault();
+
+    private:
+        typedef std::function<void(std::size_t)> task_t;
+
+        struct Queue {
+            std::mutex mutex;
+            std::deque<task_t> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> threads;
+        std::atomic<std::size_t> queued;
+        std::mutex sleepMutex;
+        std::condition_variable wakeup;
+        bool stopping;
+
+        void push(std::size_t worker, task_t&& task);
+
+        /* Takes a task from the own queue or steals one, returns <false> if all queues are empty
+         */
+        bool take(std::size_t worker, task_t& task);
+
+        void run(std::size_t worker);
+};
+
+}
+
+#endif
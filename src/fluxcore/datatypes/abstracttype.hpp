@@ -30,6 +30,19 @@ class AbstractType {
         virtual dataptr_t createPtr(void* ptr) const = 0;
         virtual dataptrconst_t createPtr(const void* ptr) const = 0;
 
+        /* Finds the smallest and the largest of <n> values
+         *
+         * @values the values, <n> has to be at least 1
+         * @min receives the smallest value
+         * @max receives the largest value
+         *
+         * Returns <false> if the type does not order its values or some of the values are unordered (NaN), <min> and
+         * <max> are undefined then.
+         */
+        virtual bool computeRange(const void* /*values*/, std::size_t /*n*/, void* /*min*/, void* /*max*/) const {
+            return false;
+        }
+
         virtual void generateDescriptor(typedescr_t::iterator& begin, typedescr_t::iterator end) const = 0;
         virtual void generateDescriptor(typedescr_t::iterator&& begin, typedescr_t::iterator end) const {
             generateDescriptor(begin, end);
@@ -1,6 +1,7 @@
 #ifndef FLUXCORE_PRIMITIVETYPE_HPP
 #define FLUXCORE_PRIMITIVETYPE_HPP
 
+#include <cstring>
 #include <stdexcept>
 
 #include "abstracttype.hpp"
@@ -70,9 +71,9 @@ class DataRefTemplate : public DataRef {
 
 template <typename H>
 class PrimitiveType : public AbstractType {
-    typedef typename H::type type;
-
     public:
+        typedef typename H::type type;
+
         static constexpr typeid_t id = H::id;
 
         virtual ~PrimitiveType() override = default;
@@ -98,6 +99,24 @@ class PrimitiveType : public AbstractType {
             return std::make_shared<DataPtrTemplate<type>>(const_cast<void*>(ptr));
         }
 
+        virtual bool computeRange(const void* values, std::size_t n, void* min, void* max) const override {
+            const type* data = static_cast<const type*>(values);
+            type lo = data[0];
+            type hi = data[0];
+            bool ordered = true;
+
+            for (std::size_t i = 0; i < n; ++i) {
+                type v = data[i];
+                ordered &= (v == v);
+                lo = (v < lo) ? v : lo;
+                hi = (v > hi) ? v : hi;
+            }
+
+            memcpy(min, &lo, sizeof(type));
+            memcpy(max, &hi, sizeof(type));
+            return ordered;
+        }
+
         virtual void generateDescriptor(typedescr_t::iterator& begin, typedescr_t::iterator end) const {
             if (begin == end) {
                 throw std::runtime_error("Typedescriptor is going to be too long!");
@@ -172,6 +172,10 @@ std::string Tuple::getName() const {
     return ss.str();
 }
 
+std::size_t Tuple::getOffset(std::size_t i) const {
+    return sizes.at(i);
+}
+
 dataptr_t Tuple::createPtr(void* ptr) const {
     return std::make_shared<TuplePtr>(ptr, basetypes, sizes);
 }
@@ -20,6 +20,10 @@ class Tuple : public AbstractType {
         virtual std::size_t getSize() const override;
         virtual std::string getName() const override;
 
+        /* Returns the offset of element <i> inside a tuple, elements are packed without padding
+         */
+        std::size_t getOffset(std::size_t i) const;
+
         virtual dataptr_t createPtr(void* ptr) const override;
         virtual dataptrconst_t createPtr(const void* ptr) const override;
 
@@ -1,19 +1,108 @@
 #include "column.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <numeric>
 
 using namespace fluxcore;
 
+constexpr std::size_t Column::chunkRows;
+constexpr std::size_t Column::blockRows;
+constexpr std::size_t Column::prefetchDistance;
+constexpr std::size_t Column::minTailRows;
+
+/* Decodes a single value of an encoded segment into memory that does not need to be aligned for the column type
+ *
+ * Only 1, 2, 4 and 8 byte values get encoded, so they always fit into the temporary.
+ */
+static void decodeValue(const SegmentHeader* header, std::size_t offset, std::size_t elementSize, void* out) {
+    std::int64_t value;
+    decodeSegment(header, offset, 1, &value);
+    memcpy(out, &value, elementSize);
+}
+
+Column::Cursor::Cursor(AbstractProvider* provider_, index_t::Iterator current_, index_t::Iterator end_, std::size_t nextRow_, std::size_t elementSize_, std::size_t tailFirstRow_, std::size_t tailRows_, const char* tailData_) :
+        provider(provider_),
+        current(current_),
+        end(end_),
+        nextRow(nextRow_),
+        elementSize(elementSize_),
+        tailFirstRow(tailFirstRow_),
+        tailRows(tailRows_),
+        tailData(tailData_) {}
+
+bool Column::Cursor::next(Span& span) {
+    if (current == end) {
+        // the unsealed tail comes last
+        std::size_t lastRow = tailFirstRow + tailRows;
+        if (nextRow >= lastRow) {
+            return false;
+        }
+
+        span.firstRow = nextRow;
+        span.rowCount = lastRow - nextRow;
+        span.data = tailData + (nextRow - tailFirstRow) * elementSize;
+
+        nextRow = lastRow;
+        return true;
+    }
+
+    // keys are the cumulative row counts, so a segment ends at its key, the pin moves on with the cursor
+    std::size_t lastRow = current.key();
+    if (pin.id() != current.record()) {
+        pin = SegmentPin(provider, current.record());
+    }
+    const SegmentHeader* header = static_cast<const SegmentHeader*>(pin.ptr());
+    std::size_t offset = nextRow - (lastRow - header->rows);
+    std::size_t n = lastRow - nextRow;
+
+    if (header->encoding == Encoding::Raw) {
+        span.data = static_cast<const char*>(segmentPayload(header)) + offset * elementSize;
+    } else {
+        n = std::min(n, blockRows);
+        buffer.resize(blockRows * elementSize);
+        decodeSegment(header, offset, n, buffer.data());
+        span.data = buffer.data();
+    }
+    span.firstRow = nextRow;
+    span.rowCount = n;
+
+    nextRow += n;
+    if (nextRow == lastRow) {
+        ++current;
+    }
+
+    return true;
+}
+
 Column::Column(const typeptr_t& type_, const provider_t& provider_) :
         type(type_),
         provider(provider_),
-        index(provider_) {
+        index(provider_),
+        sealedRows(0),
+        tailId(0),
+        tailData(nullptr),
+        tailRows(0),
+        tailCapacity(0) {
 }
 
 Column::Column(const typeptr_t& type_, const provider_t& provider_, std::size_t id_) :
         type(type_),
         provider(provider_),
-        index(provider_, id_) {}
+        index(provider_, id_),
+        sealedRows(index.empty() ? 0 : index.last().first),
+        tailId(0),
+        tailData(nullptr),
+        tailRows(0),
+        tailCapacity(0) {}
+
+Column::~Column() {
+    // an exception leaving the destructor would terminate the process
+    try {
+        flush();
+    } catch (...) {
+    }
+}
 
 std::size_t Column::getID() const {
     return index.getID();
@@ -23,21 +112,246 @@ typeptr_t Column::getType() const {
     return type;
 }
 
+std::size_t Column::size() const {
+    return sealedRows + tailRows;
+}
+
+std::size_t Column::getTailRows() const {
+    return tailRows;
+}
+
 void Column::add(const dataptrconst_t& begin, const dataptrconst_t& end) {
     // prepare plain memory operation
-    std::size_t nElements = (*begin - *end);
-    std::size_t nBytes = nElements * type->getSize();
+    std::size_t nElements = static_cast<std::size_t>(*end - *begin);
+    std::size_t elementSize = type->getSize();
+    const char* src = static_cast<const char*>(begin->get());
+
+    // fill tail, seal it whenever it is full
+    while (nElements > 0) {
+        if (tailRows == tailCapacity) {
+            // small columns start with a small tail, streams get full chunks right away
+            std::size_t capacity = (sealedRows > 0) ? chunkRows : std::max(2 * tailCapacity, minTailRows);
+            resizeTail(std::min(std::max(capacity, tailRows + nElements), chunkRows));
+        }
+
+        std::size_t n = std::min(nElements, tailCapacity - tailRows);
+        memcpy(tailData + tailRows * elementSize, src, n * elementSize);
+        tailRows += n;
+        src += n * elementSize;
+        nElements -= n;
+
+        if (tailRows == chunkRows) {
+            seal();
+        }
+    }
+}
+
+void Column::flush() {
+    if (tailRows > 0) {
+        seal();
+    }
+}
+
+Column::Chunk Column::allocateChunk(std::size_t rows) {
+    Segment s = provider->createSegment(sizeof(SegmentHeader) + rows * type->getSize());
+
+    return Chunk{s.id(), segmentPayload(static_cast<SegmentHeader*>(s.ptr())), rows};
+}
 
-    // copy data to new segment
-    Segment s = provider->createSegment(nBytes);
-    memcpy(s.ptr(), begin->get(), nBytes);
+void Column::discardChunk(const Chunk& chunk) {
+    provider->freeSegment(chunk.segmentId);
+}
+
+void Column::adoptChunk(const Chunk& chunk, bool encode) {
+    if (chunk.rows == 0) {
+        provider->freeSegment(chunk.segmentId);
+        return;
+    }
 
-    // add segment to index
-    std::size_t pos = 0;
-    if (!index.empty()) {
-        pos = index.last().first;
+    flush();
+    if (encode) {
+        // the chunk becomes a full tail, sealing keeps raw segments in place
+        tailId = chunk.segmentId;
+        tailData = static_cast<char*>(chunk.data);
+        tailRows = chunk.rows;
+        tailCapacity = chunk.rows;
+        seal();
+        return;
     }
-    index.insert(pos + nElements, s.id());
+
+    SegmentHeader* header = static_cast<SegmentHeader*>(chunk.data) - 1;
+    initRawHeader(header, chunk.rows, type->getSize());
+    setZoneMap(header, chunk.data);
+    sealedRows += chunk.rows;
+    index.insert(sealedRows, chunk.segmentId);
+    provider->unpinSegment(chunk.segmentId, true);
 }
 
+void Column::resizeTail(std::size_t capacity) {
+    // the provider keeps the rows, in place if it can
+    std::size_t bytes = sizeof(SegmentHeader) + capacity * type->getSize();
+    Segment s = (tailId != 0) ? provider->resizeSegment(tailId, bytes) : provider->createSegment(bytes);
 
+    tailId = s.id();
+    tailData = static_cast<char*>(segmentPayload(static_cast<SegmentHeader*>(s.ptr())));
+    tailCapacity = capacity;
+}
+
+void Column::seal() {
+    std::size_t elementSize = type->getSize();
+    EncodingPlan plan = planEncoding(tailData, tailRows, elementSize);
+
+    if (plan.header.encoding == Encoding::Raw) {
+        // keep the tail segment, shrink it to its content
+        if (tailRows < tailCapacity) {
+            resizeTail(tailRows);
+        }
+        SegmentHeader* header = reinterpret_cast<SegmentHeader*>(tailData) - 1;
+        initRawHeader(header, tailRows, elementSize);
+        setZoneMap(header, tailData);
+    } else {
+        setZoneMap(&plan.header, tailData);
+        Segment s = provider->createSegment(plan.bytes);
+        encodeSegment(plan, tailData, s.ptr());
+        provider->freeSegment(tailId);
+        tailId = s.id();
+    }
+
+    sealedRows += tailRows;
+    index.insert(sealedRows, tailId);
+    provider->unpinSegment(tailId, true);
+
+    tailId = 0;
+    tailData = nullptr;
+    tailRows = 0;
+    tailCapacity = 0;
+}
+
+void Column::setZoneMap(SegmentHeader* header, const void* values) const {
+    if ((type->getSize() <= sizeof(header->min)) && type->computeRange(values, header->rows, header->min, header->max)) {
+        header->flags |= segmentHasZoneMap;
+    }
+}
+
+Column::Cursor Column::scan(std::size_t fromRow) const {
+    // the first segment that ends behind <fromRow> contains it
+    index_t::Iterator it = index.lowerBound(fromRow + 1);
+    std::size_t nextRow = std::min(fromRow, size());
+
+    return Cursor(provider.get(), it, index.end(), nextRow, type->getSize(), sealedRows, tailRows, tailData);
+}
+
+std::vector<Column::Zone> Column::zones() const {
+    std::vector<Zone> result;
+
+    for (index_t::Iterator it = index.begin(); it != index.end(); ++it) {
+        SegmentPin pin(provider.get(), it.record());
+        const SegmentHeader* header = static_cast<const SegmentHeader*>(pin.ptr());
+
+        Zone zone = Zone();
+        zone.firstRow = it.key() - header->rows;
+        zone.rowCount = header->rows;
+        zone.hasRange = (header->flags & segmentHasZoneMap) != 0;
+        memcpy(zone.min, header->min, sizeof(zone.min));
+        memcpy(zone.max, header->max, sizeof(zone.max));
+        result.push_back(zone);
+    }
+
+    if (tailRows > 0) {
+        Zone zone = Zone();
+        zone.firstRow = sealedRows;
+        zone.rowCount = tailRows;
+        zone.hasRange = false;
+        result.push_back(zone);
+    }
+
+    return result;
+}
+
+void Column::get(std::size_t rowId, void* out) const {
+    std::size_t elementSize = type->getSize();
+
+    if (rowId >= sealedRows) {
+        if (rowId >= sealedRows + tailRows) {
+            throw std::runtime_error("Row does not exist!");
+        }
+
+        memcpy(out, tailData + (rowId - sealedRows) * elementSize, elementSize);
+        return;
+    }
+
+    index_t::Iterator it = index.lowerBound(rowId + 1);
+    SegmentPin pin(provider.get(), it.record());
+    const SegmentHeader* header = static_cast<const SegmentHeader*>(pin.ptr());
+
+    std::size_t offset = rowId - (it.key() - header->rows);
+    if (header->encoding == Encoding::Raw) {
+        memcpy(out, static_cast<const char*>(segmentPayload(header)) + offset * elementSize, elementSize);
+    } else {
+        decodeValue(header, offset, elementSize, out);
+    }
+}
+
+void Column::gather(const std::vector<std::size_t>& rowIds, void* out) const {
+    std::size_t n = rowIds.size();
+    std::size_t elementSize = type->getSize();
+
+    // Step 1: visit rows in sorted order, so each segment gets resolved once
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    if (!std::is_sorted(rowIds.cbegin(), rowIds.cend())) {
+        std::sort(order.begin(), order.end(), [&rowIds](std::size_t a, std::size_t b) {
+            return rowIds[a] < rowIds[b];
+        });
+    }
+
+    // Step 2: copy under a single rolling pin, so the call never holds more than one segment, the writes scatter
+    // to the positions in <out> and get prefetched ahead
+    char* target = static_cast<char*>(out);
+    SegmentPin pin;
+    const SegmentHeader* header = nullptr;
+    const char* base = nullptr;
+    std::size_t firstRow = 0;
+    std::size_t lastRow = 0;
+    for (std::size_t k = 0; k < n; ++k) {
+        std::size_t i = order[k];
+        std::size_t rowId = rowIds[i];
+
+        if (k + prefetchDistance < n) {
+            __builtin_prefetch(target + order[k + prefetchDistance] * elementSize, 1);
+        }
+
+        if (((base == nullptr) && (header == nullptr)) || (rowId >= lastRow)) {
+            if (rowId >= sealedRows + tailRows) {
+                throw std::runtime_error("Row does not exist!");
+            }
+
+            pin.release();
+            if (rowId >= sealedRows) {
+                header = nullptr;
+                base = tailData;
+                firstRow = sealedRows;
+                lastRow = sealedRows + tailRows;
+            } else {
+                index_t::Iterator it = index.lowerBound(rowId + 1);
+                pin = SegmentPin(provider.get(), it.record());
+                header = static_cast<const SegmentHeader*>(pin.ptr());
+                lastRow = it.key();
+                firstRow = lastRow - header->rows;
+
+                if (header->encoding == Encoding::Raw) {
+                    base = static_cast<const char*>(segmentPayload(header));
+                    header = nullptr;
+                } else {
+                    base = nullptr;
+                }
+            }
+        }
+
+        if (header != nullptr) {
+            decodeValue(header, rowId - firstRow, elementSize, target + i * elementSize);
+        } else {
+            memcpy(target + i * elementSize, base + (rowId - firstRow) * elementSize, elementSize);
+        }
+    }
+}
@@ -1,31 +1,310 @@
 #ifndef FLUXCORE_COLUMN_HPP
 #define FLUXCORE_COLUMN_HPP
 
+#include <stdexcept>
+#include <vector>
+
 #include "../datatypes/abstracttype.hpp"
 #include "provider/abstractprovider.hpp"
+#include "encoding.hpp"
 #include "index.hpp"
 
 namespace fluxcore {
 
+/* Column of values of a single type
+ *
+ * Values are stored in segments of up to <chunkRows> rows. The index maps the cumulative row count behind each sealed
+ * segment to its id. Appends are collected in an unsealed tail segment, which gets sealed into the index when it is
+ * full or when <flush> gets called, so the segment size does not depend on the batch size of the callers.
+ *
+ * Every segment starts with a <SegmentHeader>. Sealing picks the smallest encoding for the values of the segment, see
+ * <planEncoding>, and stores min and max of the values in the header. These zone maps persist with the segments and
+ * let filters skip segments without touching their payload, see <zones>.
+ *
+ * Bulk loaders can skip the copy entirely: <allocateChunk> hands out a provider segment that gets filled in place and
+ * <adoptChunk> adds it to the index as it is.
+ *
+ * Only the tail stays pinned. Sealed segments are pinned while they get read, so providers with eviction can move cold
+ * segments out of memory, see <BufferPoolProvider>.
+ */
 class Column {
+    typedef Index<std::size_t, 16> index_t;
+
     public:
+        /* Number of rows of a sealed tail segment, flushed tails may be smaller and adopted chunks can have any size
+         */
+        static constexpr std::size_t chunkRows = 65536;
+
+        /* Maximal number of rows of spans that get decoded by a cursor
+         */
+        static constexpr std::size_t blockRows = 1024;
+
+        /* Contiguous run of rows that is stored in a single segment
+         *
+         * <data> holds <rowCount> values of the column type. For raw segments it points directly into provider memory,
+         * encoded segments get decoded into a buffer of the cursor in blocks of <blockRows> rows.
+         */
+        struct Span {
+            std::size_t firstRow;
+            std::size_t rowCount;
+            const void* data;
+        };
+
+        /* Cursor that walks the segments of a column in row order
+         *
+         * The cursor gets invalidated by every modification of the column. Spans of encoded segments are only valid
+         * until the next call of <next>. The cursor keeps the segment of the last span pinned, spans of raw segments stay
+         * valid until the cursor moves on to the next segment.
+         */
+        class Cursor {
+            public:
+                /* Moves to the next span
+                 *
+                 * @span receives the next span
+                 *
+                 * @return <false> if the end of the column was reached, <span> stays untouched in this case
+                 */
+                bool next(Span& span);
+
+            private:
+                friend class Column;
+
+                AbstractProvider* provider;
+                index_t::Iterator current;
+                index_t::Iterator end;
+                std::size_t nextRow;
+                std::size_t elementSize;
+                std::size_t tailFirstRow;
+                std::size_t tailRows;
+                const char* tailData;
+                std::vector<char> buffer;
+                SegmentPin pin;
+
+                Cursor(AbstractProvider* provider_, index_t::Iterator current_, index_t::Iterator end_, std::size_t nextRow_, std::size_t elementSize_, std::size_t tailFirstRow_, std::size_t tailRows_, const char* tailData_);
+        };
+
+        /* Statistics of the rows of a single segment, see <zones>
+         *
+         * <min> and <max> hold values of the column type and are only valid if <hasRange> is set.
+         */
+        struct Zone {
+            std::size_t firstRow;
+            std::size_t rowCount;
+            bool hasRange;
+            char min[8];
+            char max[8];
+        };
+
+        /* Writable segment for zero-copy ingest, see <allocateChunk>
+         */
+        struct Chunk {
+            std::size_t segmentId;
+            void* data;
+            std::size_t rows;
+        };
+
         Column(const typeptr_t& type_, const provider_t& provider_);
         Column(const typeptr_t& type_, const provider_t& provider_, std::size_t id_);
+        Column(const Column&) = delete;
 
+        /* Flushes the tail
+         *
+         * Errors while flushing (e.g. a provider running out of space) are swallowed, call <flush()> explicitly to see
+         * them.
+         */
+        ~Column();
+
+        /* Returns id of the index, which can be used to load the column later
+         *
+         * Only rows that were sealed or flushed before are visible to loaded columns.
+         */
         std::size_t getID() const;
         typeptr_t getType() const;
 
+        /* Returns the number of rows stored in the column
+         */
+        std::size_t size() const;
+
+        /* Returns the number of rows in the unsealed tail
+         */
+        std::size_t getTailRows() const;
+
+        /* Appends values to the column
+         *
+         * @begin pointer to the first value
+         * @end pointer behind the last value
+         *
+         * The values are copied into the tail segment, which gets sealed whenever it reaches <chunkRows> rows.
+         */
         void add(const dataptrconst_t& begin, const dataptrconst_t& end);
 
+        /* Seals the tail segment into the index, even if it is not full
+         *
+         * Does nothing if the tail is empty.
+         */
+        void flush();
+
+        /* Allocates a segment that can be filled with values and then gets adopted by <adoptChunk>
+         *
+         * @rows number of values the chunk stores
+         *
+         * The segment is not part of the column until it gets adopted. Chunks that are not adopted have to be
+         * discarded.
+         */
+        Chunk allocateChunk(std::size_t rows);
+
+        /* Frees a chunk that was not adopted
+         */
+        void discardChunk(const Chunk& chunk);
+
+        /* Appends a completely filled chunk without copying it
+         *
+         * @chunk chunk returned by <allocateChunk> of this column
+         * @encode <true> if the chunk should get the encoding that sealing the tail would pick
+         *
+         * The tail gets flushed first to keep the row order, then the segment gets added to the index. Without
+         * <encode> it always stays raw, otherwise only chunks that are not worth encoding are kept in place.
+         */
+        void adoptChunk(const Chunk& chunk, bool encode = false);
+
+        /* Creates a cursor over all rows starting at <fromRow>
+         *
+         * @fromRow first row that should be part of the scan
+         *
+         * The first span starts exactly at <fromRow>, even if that is in the middle of a segment. Raw segments do not get
+         * copied.
+         */
+        Cursor scan(std::size_t fromRow = 0) const;
+
+        /* Returns the zone maps of all segments in row order
+         *
+         * Only the segment headers get read. Segments whose values are unordered or larger than 8 bytes have no range,
+         * neither has the unsealed tail, which is always the last zone if it is not empty.
+         */
+        std::vector<Zone> zones() const;
+
+        /* Copies the value of a single row
+         *
+         * @rowId position of the row
+         * @out target memory, must provide space for one value of the column type
+         *
+         * The owning segment is found through the index, so this costs O(log n) plus the random access into the
+         * encoded segment.
+         */
+        void get(std::size_t rowId, void* out) const;
+
+        /* Copies the values of multiple rows
+         *
+         * @rowIds positions of the rows, may be unsorted and contain duplicates
+         * @out target memory, must provide space for <rowIds.size()> values of the column type
+         *
+         * The values are written in the order of <rowIds>. Rows are copied in sorted order, so every segment gets
+         * looked up and pinned only once per call, and only one segment is pinned at a time. The scattered writes into
+         * <out> get prefetched ahead.
+         */
+        void gather(const std::vector<std::size_t>& rowIds, void* out) const;
+
     private:
+        static constexpr std::size_t prefetchDistance = 8;
+        static constexpr std::size_t minTailRows = 1024;
+
         typeptr_t type;
         provider_t provider;
-        Index<std::size_t, 16> index;
+        index_t index;
+        std::size_t sealedRows;
+        std::size_t tailId;
+        char* tailData;
+        std::size_t tailRows;
+        std::size_t tailCapacity;
+
+        /* Resizes the tail segment to <capacity> rows, creates it if there is none
+         */
+        void resizeTail(std::size_t capacity);
+
+        /* Encodes the tail segment and adds it to the index, the tail must not be empty
+         */
+        void seal();
+
+        /* Stores the zone map of <header->rows> values in <header>
+         */
+        void setZoneMap(SegmentHeader* header, const void* values) const;
 };
 
 typedef std::shared_ptr<Column> column_t;
 
+/* Typed read access to a column of primitive values
+ *
+ * @T C++ type of the values, e.g. <int_t> for a column of <Int>
+ *
+ * Only the size of <T> can be checked against the column type, so the caller is responsible to pick the matching type.
+ */
+template <typename T>
+class ColumnView {
+    public:
+        struct Span {
+            std::size_t firstRow;
+            std::size_t rowCount;
+            const T* data;
+        };
+
+        class Cursor {
+            public:
+                /* Moves to the next span
+                 *
+                 * @span receives the next span
+                 *
+                 * @return <false> if the end of the column was reached
+                 */
+                bool next(Span& span) {
+                    Column::Span raw;
+                    if (!cursor.next(raw)) {
+                        return false;
+                    }
+
+                    span.firstRow = raw.firstRow;
+                    span.rowCount = raw.rowCount;
+                    span.data = static_cast<const T*>(raw.data);
+                    return true;
+                }
+
+            private:
+                friend class ColumnView;
+
+                Column::Cursor cursor;
+
+                explicit Cursor(Column::Cursor cursor_) : cursor(cursor_) {}
+        };
+
+        explicit ColumnView(const column_t& column_) : column(column_) {
+            if (column->getType()->getSize() != sizeof(T)) {
+                throw std::runtime_error("Type does not match the column!");
+            }
+        }
+
+        std::size_t size() const {
+            return column->size();
+        }
+
+        T get(std::size_t rowId) const {
+            T value;
+            column->get(rowId, &value);
+            return value;
+        }
+
+        void gather(const std::vector<std::size_t>& rowIds, T* out) const {
+            column->gather(rowIds, out);
+        }
+
+        /* Creates a cursor over all rows starting at <fromRow>
+         */
+        Cursor scan(std::size_t fromRow = 0) const {
+            return Cursor(column->scan(fromRow));
+        }
+
+    private:
+        column_t column;
+};
+
 }
 
 #endif
-
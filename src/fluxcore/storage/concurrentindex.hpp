@@ -0,0 +1,507 @@
+#ifndef FLUXCORE_CONCURRENTINDEX_HPP
+#define FLUXCORE_CONCURRENTINDEX_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+
+#include "keysearch.hpp"
+#include "provider/abstractprovider.hpp"
+
+namespace fluxcore {
+
+/* Concurrent index that maps keys to <std::size_t>
+ *
+ * @K type of the keys
+ * @nodeSize number of stored keys per node
+ *
+ * The index is a B+ tree synchronized by optimistic lock coupling: every node carries a version counter. Readers never
+ * write to shared memory, they remember the versions of the nodes they pass and restart if one of them changed in the
+ * meantime. Writers only latch the nodes they modify and split full nodes eagerly on the way down, so a split never
+ * has to propagate upwards.
+ *
+ * Nodes are stored in provider segments but linked by pointers, so the index lives in memory only and cannot be
+ * reloaded. Nodes are never freed while the index exists (there are no merges), which is what makes it safe for
+ * readers to follow pointers that were read optimistically. Segment allocation is serialized by an internal mutex,
+ * so the provider does not have to be thread-safe as long as nobody else uses it concurrently.
+ */
+template <typename K, std::size_t nodeSize = 64>
+class ConcurrentIndex {
+    static_assert(nodeSize >= 3, "Nodes have to store at least 3 keys!");
+
+    public:
+        /* Creates new, empty index
+         *
+         * @provider_ StorageProvider used to store the nodes
+         */
+        explicit ConcurrentIndex(const provider_t& provider_) : provider(provider_) {
+            root.store(createLeaf());
+        }
+
+        ConcurrentIndex(const ConcurrentIndex&) = delete;
+        ConcurrentIndex& operator=(const ConcurrentIndex&) = delete;
+
+        ~ConcurrentIndex() {
+            freeNode(root.load());
+        }
+
+        /* Inserts or updates a record
+         *
+         * @key the key of the record
+         * @record record that gets assoziated to the key
+         *
+         * @return <true> if the key was new, <false> if an existing record got replaced
+         */
+        bool insert(const K& key, std::size_t record) {
+            while (true) {
+                bool restart = false;
+                Node* node = root.load();
+                std::uint64_t version = node->readLock(restart);
+                if (restart || (node != root.load())) {
+                    continue;
+                }
+
+                Inner* parent = nullptr;
+                std::uint64_t parentVersion = 0;
+
+                while (!node->leaf) {
+                    Inner* inner = static_cast<Inner*>(node);
+
+                    if (inner->count == nodeSize) {
+                        splitInner(parent, parentVersion, inner, version, restart);
+                        break;
+                    }
+
+                    if (parent != nullptr) {
+                        parent->readUnlock(parentVersion, restart);
+                        if (restart) {
+                            break;
+                        }
+                    }
+
+                    parent = inner;
+                    parentVersion = version;
+
+                    node = inner->children[KeySearch<K>::upper(inner->keys, inner->count, key)];
+                    inner->check(version, restart);
+                    if (restart) {
+                        break;
+                    }
+                    version = node->readLock(restart);
+                    if (restart) {
+                        break;
+                    }
+                }
+
+                if (restart || !node->leaf) {
+                    continue;
+                }
+
+                Leaf* leaf = static_cast<Leaf*>(node);
+                if (leaf->count == nodeSize) {
+                    splitLeaf(parent, parentVersion, leaf, version);
+                    continue;
+                }
+
+                leaf->upgradeToWriteLock(version, restart);
+                if (restart) {
+                    continue;
+                }
+                if (parent != nullptr) {
+                    parent->readUnlock(parentVersion, restart);
+                    if (restart) {
+                        leaf->writeUnlock();
+                        continue;
+                    }
+                }
+
+                bool inserted = leaf->insert(key, record);
+                leaf->writeUnlock();
+                return inserted;
+            }
+        }
+
+        /* Looks up a record
+         *
+         * @key the search key
+         * @record receives the record if the key was found
+         *
+         * @return <true> if the key was found
+         */
+        bool lookup(const K& key, std::size_t& record) const {
+            while (true) {
+                bool restart = false;
+                std::uint64_t version;
+                Leaf* leaf = findLeaf(key, version, restart);
+                if (restart) {
+                    continue;
+                }
+
+                std::size_t pos = KeySearch<K>::lower(leaf->keys, leaf->count, key);
+                bool found = (pos < leaf->count) && (leaf->keys[pos] == key);
+                std::size_t result = found ? leaf->records[pos] : 0;
+
+                leaf->readUnlock(version, restart);
+                if (restart) {
+                    continue;
+                }
+
+                if (found) {
+                    record = result;
+                }
+                return found;
+            }
+        }
+
+        /* Copies records in key order, starting with the first key not less than <key>
+         *
+         * @key the start key
+         * @max maximal number of records to copy
+         * @out target of the records, must provide space for <max> records
+         *
+         * @return number of copied records
+         *
+         * Each leaf gets copied atomically. Records that get inserted concurrently may or may not be part of the
+         * result.
+         */
+        std::size_t scan(const K& key, std::size_t max, std::pair<K, std::size_t>* out) const {
+            std::size_t n = 0;
+            K from = key;
+            bool exclusive = false;
+
+            while (n < max) {
+                bool restart = false;
+                std::uint64_t version;
+                Leaf* leaf = findLeaf(from, version, restart);
+                if (restart) {
+                    continue;
+                }
+
+                // walk the leaf chain, copy every leaf under its version
+                while ((leaf != nullptr) && (n < max)) {
+
+                    std::size_t pos = exclusive ? KeySearch<K>::upper(leaf->keys, leaf->count, from) : KeySearch<K>::lower(leaf->keys, leaf->count, from);
+                    std::size_t copied = 0;
+                    for (; (pos < leaf->count) && (n + copied < max); ++pos, ++copied) {
+                        out[n + copied] = std::make_pair(leaf->keys[pos], leaf->records[pos]);
+                    }
+                    Leaf* next = leaf->right;
+
+                    leaf->readUnlock(version, restart);
+                    if (restart) {
+                        break;
+                    }
+
+                    if (copied > 0) {
+                        n += copied;
+                        from = out[n - 1].first;
+                        exclusive = true;
+                    }
+                    leaf = next;
+                    if (leaf != nullptr) {
+                        version = leaf->readLock(restart);
+                        if (restart) {
+                            break;
+                        }
+                    }
+                }
+
+                if (!restart) {
+                    break;
+                }
+            }
+
+            return n;
+        }
+
+    private:
+        struct Node {
+            std::atomic<std::uint64_t> version;
+            std::size_t segmentId;
+            std::size_t count;
+            bool leaf;
+
+            Node(std::size_t segmentId_, bool leaf_) : version(0), segmentId(segmentId_), count(0), leaf(leaf_) {}
+
+            /* Waits until the node is unlocked and returns its version
+             */
+            std::uint64_t readLock(bool& restart) const {
+                std::uint64_t v = version.load();
+                for (std::size_t spins = 0; isLocked(v); ++spins) {
+                    if (spins > 64) {
+                        std::this_thread::yield();
+                    }
+                    v = version.load();
+                }
+
+                if (isObsolete(v)) {
+                    restart = true;
+                }
+                return v;
+            }
+
+            /* Validates that the node did not change since <readLock> returned <v>
+             */
+            void readUnlock(std::uint64_t v, bool& restart) const {
+                if (v != version.load()) {
+                    restart = true;
+                }
+            }
+
+            void check(std::uint64_t v, bool& restart) const {
+                readUnlock(v, restart);
+            }
+
+            void upgradeToWriteLock(std::uint64_t& v, bool& restart) {
+                if (version.compare_exchange_strong(v, v + lockBit)) {
+                    v += lockBit;
+                } else {
+                    restart = true;
+                }
+            }
+
+            void writeUnlock() {
+                version.fetch_add(lockBit);
+            }
+
+            static bool isLocked(std::uint64_t v) {
+                return (v & lockBit) == lockBit;
+            }
+
+            static bool isObsolete(std::uint64_t v) {
+                return (v & obsoleteBit) == obsoleteBit;
+            }
+        };
+
+        struct Leaf : Node {
+            K keys[nodeSize];
+            std::size_t records[nodeSize];
+            Leaf* right;
+
+            explicit Leaf(std::size_t segmentId_) : Node(segmentId_, true), right(nullptr) {}
+
+            bool insert(const K& key, std::size_t record) {
+                std::size_t pos = KeySearch<K>::lower(keys, this->count, key);
+
+                if ((pos < this->count) && (keys[pos] == key)) {
+                    records[pos] = record;
+                    return false;
+                }
+
+                std::copy_backward(keys + pos, keys + this->count, keys + this->count + 1);
+                std::copy_backward(records + pos, records + this->count, records + this->count + 1);
+                keys[pos] = key;
+                records[pos] = record;
+                ++this->count;
+
+                return true;
+            }
+
+            /* Moves the upper half into <other>, returns the separator
+             */
+            K split(Leaf* other) {
+                std::size_t mid = this->count / 2;
+
+                std::copy(keys + mid, keys + this->count, other->keys);
+                std::copy(records + mid, records + this->count, other->records);
+                other->count = this->count - mid;
+                other->right = right;
+                this->count = mid;
+                right = other;
+
+                return other->keys[0];
+            }
+        };
+
+        struct Inner : Node {
+            K keys[nodeSize];
+            Node* children[nodeSize + 1];
+
+            explicit Inner(std::size_t segmentId_) : Node(segmentId_, false) {}
+
+            /* Adds a separator and the child on its right side
+             */
+            void insert(const K& key, Node* child) {
+                std::size_t pos = KeySearch<K>::upper(keys, this->count, key);
+
+                std::copy_backward(keys + pos, keys + this->count, keys + this->count + 1);
+                std::copy_backward(children + pos + 1, children + this->count + 1, children + this->count + 2);
+                keys[pos] = key;
+                children[pos + 1] = child;
+                ++this->count;
+            }
+
+            /* Moves the upper half into <other>, returns the separator that got pushed out
+             */
+            K split(Inner* other) {
+                std::size_t mid = this->count / 2;
+                K separator = keys[mid];
+
+                std::copy(keys + mid + 1, keys + this->count, other->keys);
+                std::copy(children + mid + 1, children + this->count + 1, other->children);
+                other->count = this->count - mid - 1;
+                this->count = mid;
+
+                return separator;
+            }
+        };
+
+        static constexpr std::uint64_t obsoleteBit = 1;
+        static constexpr std::uint64_t lockBit = 2;
+
+        provider_t provider;
+        std::mutex allocMutex;
+        std::atomic<Node*> root;
+
+        Leaf* createLeaf() {
+            std::lock_guard<std::mutex> lock(allocMutex);
+            Segment s = provider->createSegment(sizeof(Leaf));
+            provider->keepResident(s.id());
+            return new (s.ptr()) Leaf(s.id());
+        }
+
+        Inner* createInner() {
+            std::lock_guard<std::mutex> lock(allocMutex);
+            Segment s = provider->createSegment(sizeof(Inner));
+            provider->keepResident(s.id());
+            return new (s.ptr()) Inner(s.id());
+        }
+
+        void freeNode(Node* node) {
+            if (!node->leaf) {
+                Inner* inner = static_cast<Inner*>(node);
+                for (std::size_t i = 0; i <= inner->count; ++i) {
+                    freeNode(inner->children[i]);
+                }
+            }
+
+            std::size_t segmentId = node->segmentId;
+            if (node->leaf) {
+                static_cast<Leaf*>(node)->~Leaf();
+            } else {
+                static_cast<Inner*>(node)->~Inner();
+            }
+            provider->freeSegment(segmentId);
+        }
+
+        /* Descends to the leaf that covers <key>
+         *
+         * On success, <version> receives the version of the returned leaf, which was read while its parent was still
+         * unchanged.
+         */
+        Leaf* findLeaf(const K& key, std::uint64_t& version, bool& restart) const {
+            Node* node = root.load();
+            version = node->readLock(restart);
+            if (restart || (node != root.load())) {
+                restart = true;
+                return nullptr;
+            }
+
+            while (!node->leaf) {
+                Inner* inner = static_cast<Inner*>(node);
+                Node* child = inner->children[KeySearch<K>::upper(inner->keys, inner->count, key)];
+
+                inner->check(version, restart);
+                if (restart) {
+                    return nullptr;
+                }
+
+                std::uint64_t childVersion = child->readLock(restart);
+                inner->readUnlock(version, restart);
+                if (restart) {
+                    return nullptr;
+                }
+
+                node = child;
+                version = childVersion;
+            }
+
+            return static_cast<Leaf*>(node);
+        }
+
+        /* Splits a full inner node, the caller restarts afterwards
+         */
+        void splitInner(Inner* parent, std::uint64_t parentVersion, Inner* inner, std::uint64_t version, bool& restart) {
+            lockParentAndNode(parent, parentVersion, inner, version, restart);
+            if (restart) {
+                return;
+            }
+
+            Inner* other = createInner();
+            K separator = inner->split(other);
+            attach(parent, inner, separator, other);
+            restart = true;
+        }
+
+        /* Splits a full leaf, the caller restarts afterwards
+         */
+        void splitLeaf(Inner* parent, std::uint64_t parentVersion, Leaf* leaf, std::uint64_t version) {
+            bool restart = false;
+            lockParentAndNode(parent, parentVersion, leaf, version, restart);
+            if (restart) {
+                return;
+            }
+
+            Leaf* other = createLeaf();
+            K separator = leaf->split(other);
+            attach(parent, leaf, separator, other);
+        }
+
+        /* Write locks parent (if any) and node, fails if the node was the root and is not anymore
+         */
+        void lockParentAndNode(Inner* parent, std::uint64_t& parentVersion, Node* node, std::uint64_t& version, bool& restart) {
+            if (parent != nullptr) {
+                parent->upgradeToWriteLock(parentVersion, restart);
+                if (restart) {
+                    return;
+                }
+            }
+
+            node->upgradeToWriteLock(version, restart);
+            if (restart) {
+                if (parent != nullptr) {
+                    parent->writeUnlock();
+                }
+                return;
+            }
+
+            if ((parent == nullptr) && (node != root.load())) {
+                node->writeUnlock();
+                restart = true;
+            }
+        }
+
+        /* Links a split result into the parent (or a new root) and releases the locks
+         */
+        void attach(Inner* parent, Node* node, const K& separator, Node* other) {
+            if (parent != nullptr) {
+                parent->insert(separator, other);
+            } else {
+                Inner* newRoot = createInner();
+                newRoot->count = 1;
+                newRoot->keys[0] = separator;
+                newRoot->children[0] = node;
+                newRoot->children[1] = other;
+                root.store(newRoot);
+            }
+
+            node->writeUnlock();
+            if (parent != nullptr) {
+                parent->writeUnlock();
+            }
+        }
+};
+
+template <typename K, std::size_t nodeSize>
+constexpr std::uint64_t ConcurrentIndex<K, nodeSize>::obsoleteBit;
+
+template <typename K, std::size_t nodeSize>
+constexpr std::uint64_t ConcurrentIndex<K, nodeSize>::lockBit;
+
+}
+
+#endif
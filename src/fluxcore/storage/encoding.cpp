@@ -0,0 +1,371 @@
+#include "encoding.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+using namespace fluxcore;
+
+// Values are handled as signed integers of their width. Widening them to int64 and narrowing them back is lossless, and
+// all arithmetic on them is done on uint64, so it wraps instead of overflowing.
+
+static constexpr std::size_t blockSize = 256;
+static constexpr std::size_t maxDictionary = 65536;
+
+static unsigned bitsFor(std::uint64_t x) {
+    return (x == 0) ? 0 : 64 - static_cast<unsigned>(__builtin_clzll(x));
+}
+
+static std::size_t packedBytes(std::size_t n, unsigned bitWidth) {
+    return (n * bitWidth + 63) / 64 * 8;
+}
+
+static void packBits(std::uint64_t* words, unsigned bitWidth, std::size_t i, std::uint64_t v) {
+    if (bitWidth == 0) {
+        return;
+    }
+
+    std::size_t bit = i * bitWidth;
+    std::size_t w = bit >> 6;
+    unsigned shift = static_cast<unsigned>(bit & 63);
+
+    words[w] |= v << shift;
+    if (shift + bitWidth > 64) {
+        words[w + 1] |= v >> (64 - shift);
+    }
+}
+
+static void unpackBits(const std::uint64_t* words, unsigned bitWidth, std::size_t first, std::size_t count, std::uint64_t* out) {
+    if (bitWidth == 0) {
+        std::fill(out, out + count, 0);
+        return;
+    }
+
+    const std::uint64_t mask = (bitWidth == 64) ? ~UINT64_C(0) : ((UINT64_C(1) << bitWidth) - 1);
+    std::size_t bit = first * bitWidth;
+
+    for (std::size_t i = 0; i < count; ++i, bit += bitWidth) {
+        std::size_t w = bit >> 6;
+        unsigned shift = static_cast<unsigned>(bit & 63);
+
+        std::uint64_t v = words[w] >> shift;
+        if (shift + bitWidth > 64) {
+            v |= words[w + 1] << (64 - shift);
+        }
+        out[i] = v & mask;
+    }
+}
+
+static std::uint64_t diff(std::int64_t a, std::int64_t b) {
+    return static_cast<std::uint64_t>(a) - static_cast<std::uint64_t>(b);
+}
+
+static std::int64_t add(std::int64_t a, std::uint64_t b) {
+    return static_cast<std::int64_t>(static_cast<std::uint64_t>(a) + b);
+}
+
+template <typename T>
+static std::vector<std::int64_t> distinctValues(const T* values, std::size_t rows) {
+    std::vector<std::int64_t> result(values, values + rows);
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+}
+
+static void consider(EncodingPlan& best, Encoding encoding, std::size_t bytes, unsigned bitWidth, std::int64_t reference, std::int64_t base, std::size_t nEntries) {
+    if (bytes < best.bytes) {
+        best.header.encoding = encoding;
+        best.header.bitWidth = static_cast<std::uint8_t>(bitWidth);
+        best.header.reference = reference;
+        best.header.base = base;
+        best.header.nEntries = nEntries;
+        best.bytes = bytes;
+    }
+}
+
+template <typename T>
+static void planT(const T* values, std::size_t rows, EncodingPlan& best) {
+    if (rows == 0) {
+        return;
+    }
+
+    // Step 1: collect statistics in a single pass
+    std::int64_t minValue = values[0];
+    std::int64_t maxValue = values[0];
+    std::int64_t minDelta = std::numeric_limits<std::int64_t>::max();
+    std::int64_t maxDelta = std::numeric_limits<std::int64_t>::min();
+    std::size_t runs = 1;
+
+    for (std::size_t i = 1; i < rows; ++i) {
+        std::int64_t v = values[i];
+        std::int64_t prev = values[i - 1];
+
+        minValue = std::min(minValue, v);
+        maxValue = std::max(maxValue, v);
+        runs += (v != prev) ? 1 : 0;
+
+        if (i % deltaInterval != 0) {
+            std::int64_t d = static_cast<std::int64_t>(diff(v, prev));
+            minDelta = std::min(minDelta, d);
+            maxDelta = std::max(maxDelta, d);
+        }
+    }
+
+    // Step 2: compute the size of every candidate
+    const std::size_t headerSize = sizeof(SegmentHeader);
+
+    unsigned forWidth = bitsFor(diff(maxValue, minValue));
+    consider(best, Encoding::FrameOfReference, headerSize + packedBytes(rows, forWidth), forWidth, minValue, 0, 0);
+
+    std::size_t nCheckpoints = (rows + deltaInterval - 1) / deltaInterval;
+    if (minDelta > maxDelta) {
+        // only checkpoints
+        minDelta = maxDelta = 0;
+    }
+    unsigned deltaWidth = bitsFor(diff(maxDelta, minDelta));
+    consider(best, Encoding::Delta, headerSize + nCheckpoints * 8 + packedBytes(rows, deltaWidth), deltaWidth, 0, minDelta, nCheckpoints);
+
+    consider(best, Encoding::RunLength, headerSize + runs * 12, 0, 0, 0, runs);
+
+    // a dictionary can only beat frame-of-reference with less bits per code
+    if (forWidth > 1) {
+        std::size_t nDistinct = distinctValues(values, rows).size();
+        if (nDistinct <= maxDictionary) {
+            unsigned dictWidth = bitsFor(nDistinct - 1);
+            consider(best, Encoding::Dictionary, headerSize + nDistinct * 8 + packedBytes(rows, dictWidth), dictWidth, 0, 0, nDistinct);
+        }
+    }
+}
+
+template <typename T>
+static void encodeT(const SegmentHeader& header, const T* values, void* payload) {
+    std::size_t rows = header.rows;
+    unsigned bitWidth = header.bitWidth;
+
+    switch (header.encoding) {
+        case Encoding::Raw:
+            memcpy(payload, values, rows * sizeof(T));
+            break;
+
+        case Encoding::FrameOfReference: {
+            std::uint64_t* words = static_cast<std::uint64_t*>(payload);
+            memset(words, 0, packedBytes(rows, bitWidth));
+            for (std::size_t i = 0; i < rows; ++i) {
+                packBits(words, bitWidth, i, diff(values[i], header.reference));
+            }
+            break;
+        }
+
+        case Encoding::Delta: {
+            std::int64_t* checkpoints = static_cast<std::int64_t*>(payload);
+            std::uint64_t* words = reinterpret_cast<std::uint64_t*>(checkpoints + header.nEntries);
+            memset(words, 0, packedBytes(rows, bitWidth));
+            for (std::size_t i = 0; i < rows; ++i) {
+                if (i % deltaInterval == 0) {
+                    checkpoints[i / deltaInterval] = values[i];
+                } else {
+                    std::int64_t d = static_cast<std::int64_t>(diff(values[i], values[i - 1]));
+                    packBits(words, bitWidth, i, diff(d, header.base));
+                }
+            }
+            break;
+        }
+
+        case Encoding::Dictionary: {
+            std::vector<std::int64_t> dictionary = distinctValues(values, rows);
+            std::int64_t* entries = static_cast<std::int64_t*>(payload);
+            std::uint64_t* words = reinterpret_cast<std::uint64_t*>(entries + dictionary.size());
+            std::copy(dictionary.cbegin(), dictionary.cend(), entries);
+            memset(words, 0, packedBytes(rows, bitWidth));
+            for (std::size_t i = 0; i < rows; ++i) {
+                std::int64_t v = values[i];
+                std::size_t code = static_cast<std::size_t>(std::lower_bound(dictionary.cbegin(), dictionary.cend(), v) - dictionary.cbegin());
+                packBits(words, bitWidth, i, code);
+            }
+            break;
+        }
+
+        case Encoding::RunLength: {
+            std::int64_t* runValues = static_cast<std::int64_t*>(payload);
+            std::uint32_t* runEnds = reinterpret_cast<std::uint32_t*>(runValues + header.nEntries);
+            std::size_t run = 0;
+            for (std::size_t i = 0; i < rows; ++i) {
+                if ((i > 0) && (values[i] != values[i - 1])) {
+                    runEnds[run] = static_cast<std::uint32_t>(i);
+                    ++run;
+                }
+                runValues[run] = values[i];
+            }
+            runEnds[run] = static_cast<std::uint32_t>(rows);
+            break;
+        }
+    }
+}
+
+template <typename T>
+static void decodeT(const SegmentHeader* header, std::size_t first, std::size_t count, T* out) {
+    const void* payload = segmentPayload(header);
+    unsigned bitWidth = header->bitWidth;
+    std::uint64_t codes[blockSize];
+
+    switch (header->encoding) {
+        case Encoding::Raw:
+            memcpy(out, static_cast<const T*>(payload) + first, count * sizeof(T));
+            break;
+
+        case Encoding::FrameOfReference: {
+            const std::uint64_t* words = static_cast<const std::uint64_t*>(payload);
+            for (std::size_t done = 0; done < count; done += blockSize) {
+                std::size_t n = std::min(blockSize, count - done);
+                unpackBits(words, bitWidth, first + done, n, codes);
+                for (std::size_t i = 0; i < n; ++i) {
+                    out[done + i] = static_cast<T>(add(header->reference, codes[i]));
+                }
+            }
+            break;
+        }
+
+        case Encoding::Delta: {
+            const std::int64_t* checkpoints = static_cast<const std::int64_t*>(payload);
+            const std::uint64_t* words = reinterpret_cast<const std::uint64_t*>(checkpoints + header->nEntries);
+            std::size_t end = first + count;
+            std::int64_t v = 0;
+
+            // start at the checkpoint in front of <first>
+            for (std::size_t pos = first / deltaInterval * deltaInterval; pos < end; pos += blockSize) {
+                std::size_t n = std::min(blockSize, end - pos);
+                unpackBits(words, bitWidth, pos, n, codes);
+                for (std::size_t i = 0; i < n; ++i) {
+                    std::size_t row = pos + i;
+                    if (row % deltaInterval == 0) {
+                        v = checkpoints[row / deltaInterval];
+                    } else {
+                        v = add(v, static_cast<std::uint64_t>(header->base) + codes[i]);
+                    }
+                    if (row >= first) {
+                        out[row - first] = static_cast<T>(v);
+                    }
+                }
+            }
+            break;
+        }
+
+        case Encoding::Dictionary: {
+            const std::int64_t* entries = static_cast<const std::int64_t*>(payload);
+            const std::uint64_t* words = reinterpret_cast<const std::uint64_t*>(entries + header->nEntries);
+            for (std::size_t done = 0; done < count; done += blockSize) {
+                std::size_t n = std::min(blockSize, count - done);
+                unpackBits(words, bitWidth, first + done, n, codes);
+                for (std::size_t i = 0; i < n; ++i) {
+                    out[done + i] = static_cast<T>(entries[codes[i]]);
+                }
+            }
+            break;
+        }
+
+        case Encoding::RunLength: {
+            const std::int64_t* runValues = static_cast<const std::int64_t*>(payload);
+            const std::uint32_t* runEnds = reinterpret_cast<const std::uint32_t*>(runValues + header->nEntries);
+            std::size_t run = static_cast<std::size_t>(std::upper_bound(runEnds, runEnds + header->nEntries, first) - runEnds);
+            std::size_t row = first;
+            std::size_t end = first + count;
+            while (row < end) {
+                std::size_t runEnd = std::min(static_cast<std::size_t>(runEnds[run]), end);
+                std::fill(out + (row - first), out + (runEnd - first), static_cast<T>(runValues[run]));
+                row = runEnd;
+                ++run;
+            }
+            break;
+        }
+    }
+}
+
+void fluxcore::initRawHeader(SegmentHeader* header, std::size_t rows, std::size_t elementSize) {
+    memset(header, 0, sizeof(SegmentHeader));
+    header->encoding = Encoding::Raw;
+    header->elementSize = static_cast<std::uint32_t>(elementSize);
+    header->rows = rows;
+}
+
+EncodingPlan fluxcore::planEncoding(const void* values, std::size_t rows, std::size_t elementSize) {
+    EncodingPlan plan;
+    initRawHeader(&plan.header, rows, elementSize);
+    plan.bytes = sizeof(SegmentHeader) + rows * elementSize;
+
+    // run ends are stored as 32 bit integers
+    if (rows > std::numeric_limits<std::uint32_t>::max()) {
+        return plan;
+    }
+
+    switch (elementSize) {
+        case 1:
+            planT(static_cast<const std::int8_t*>(values), rows, plan);
+            break;
+        case 2:
+            planT(static_cast<const std::int16_t*>(values), rows, plan);
+            break;
+        case 4:
+            planT(static_cast<const std::int32_t*>(values), rows, plan);
+            break;
+        case 8:
+            planT(static_cast<const std::int64_t*>(values), rows, plan);
+            break;
+    }
+
+    return plan;
+}
+
+void fluxcore::encodeSegment(const EncodingPlan& plan, const void* values, void* target) {
+    SegmentHeader* header = static_cast<SegmentHeader*>(target);
+    *header = plan.header;
+    void* payload = segmentPayload(header);
+
+    if (plan.header.encoding == Encoding::Raw) {
+        memcpy(payload, values, plan.header.rows * plan.header.elementSize);
+        return;
+    }
+
+    switch (plan.header.elementSize) {
+        case 1:
+            encodeT(plan.header, static_cast<const std::int8_t*>(values), payload);
+            break;
+        case 2:
+            encodeT(plan.header, static_cast<const std::int16_t*>(values), payload);
+            break;
+        case 4:
+            encodeT(plan.header, static_cast<const std::int32_t*>(values), payload);
+            break;
+        case 8:
+            encodeT(plan.header, static_cast<const std::int64_t*>(values), payload);
+            break;
+        default:
+            throw std::runtime_error("Illegal element size for encoding!");
+    }
+}
+
+void fluxcore::decodeSegment(const SegmentHeader* header, std::size_t first, std::size_t count, void* out) {
+    if (header->encoding == Encoding::Raw) {
+        memcpy(out, static_cast<const char*>(segmentPayload(header)) + first * header->elementSize, count * header->elementSize);
+        return;
+    }
+
+    switch (header->elementSize) {
+        case 1:
+            decodeT(header, first, count, static_cast<std::int8_t*>(out));
+            break;
+        case 2:
+            decodeT(header, first, count, static_cast<std::int16_t*>(out));
+            break;
+        case 4:
+            decodeT(header, first, count, static_cast<std::int32_t*>(out));
+            break;
+        case 8:
+            decodeT(header, first, count, static_cast<std::int64_t*>(out));
+            break;
+        default:
+            throw std::runtime_error("Illegal element size for encoding!");
+    }
+}
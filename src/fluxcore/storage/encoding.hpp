@@ -0,0 +1,104 @@
+#ifndef FLUXCORE_ENCODING_HPP
+#define FLUXCORE_ENCODING_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fluxcore {
+
+/* Encodings of sealed column segments
+ */
+enum class Encoding : std::uint8_t {
+    Raw = 0,            // plain values
+    FrameOfReference,   // bit-packed offsets to the minimum
+    Delta,              // bit-packed differences to the predecessor, absolute checkpoints every <deltaInterval> rows
+    Dictionary,         // sorted distinct values, bit-packed codes
+    RunLength           // run values and run ends
+};
+
+/* Header in front of every sealed column segment, the payload starts behind it
+ *
+ * The header fills a whole cache line, so the payload stays aligned as well. The meaning of <reference>, <base> and
+ * <nEntries> depends on the encoding. <min> and <max> form the zone map of the segment: if <flags> contains
+ * <segmentHasZoneMap>, they hold the smallest and largest value in the representation of the column type.
+ */
+struct SegmentHeader {
+    Encoding encoding;
+    std::uint8_t bitWidth;
+    std::uint16_t flags;
+    std::uint32_t elementSize;
+    std::uint64_t rows;
+    std::int64_t reference;
+    std::int64_t base;
+    std::uint64_t nEntries;
+    char min[8];
+    char max[8];
+    std::uint64_t reserved;
+};
+
+/* Flag of <SegmentHeader::flags>, <min> and <max> are valid
+ */
+constexpr std::uint16_t segmentHasZoneMap = 1;
+
+static_assert(sizeof(SegmentHeader) == 64, "SegmentHeader has to fill exactly one cache line!");
+
+/* Result of <planEncoding>
+ */
+struct EncodingPlan {
+    SegmentHeader header;
+    std::size_t bytes; // segment size including header
+};
+
+/* Number of rows between two absolute values of delta encoded segments
+ */
+constexpr std::size_t deltaInterval = 128;
+
+/* Picks the encoding that results in the smallest segment
+ *
+ * @values values of the segment
+ * @rows number of values
+ * @elementSize size of a single value
+ *
+ * Values of 1, 2, 4 and 8 bytes are encoded as integers of that width, all other sizes are only stored raw. Since
+ * encodings work on the bit patterns, this is lossless for every type. Falls back to <Encoding::Raw> if no encoding
+ * saves space.
+ */
+EncodingPlan planEncoding(const void* values, std::size_t rows, std::size_t elementSize);
+
+/* Writes header and payload of an encoded segment
+ *
+ * @plan result of <planEncoding> for the same values
+ * @values values of the segment
+ * @target start of the segment, has to provide <plan.bytes> bytes
+ */
+void encodeSegment(const EncodingPlan& plan, const void* values, void* target);
+
+/* Writes a raw header for <rows> values of <elementSize> bytes
+ */
+void initRawHeader(SegmentHeader* header, std::size_t rows, std::size_t elementSize);
+
+/* Decodes a range of rows of a segment
+ *
+ * @header header of the segment
+ * @first first row to decode
+ * @count number of rows to decode
+ * @out target, has to provide space for <count> values
+ *
+ * Values get unpacked in blocks of 256 rows. Random access is O(1) for raw, frame-of-reference and dictionary
+ * segments, O(log runs) for run-length segments and O(deltaInterval) for delta segments.
+ */
+void decodeSegment(const SegmentHeader* header, std::size_t first, std::size_t count, void* out);
+
+/* Returns the payload of a segment
+ */
+inline const void* segmentPayload(const SegmentHeader* header) {
+    return header + 1;
+}
+
+inline void* segmentPayload(SegmentHeader* header) {
+    return header + 1;
+}
+
+}
+
+#endif
@@ -3,32 +3,214 @@
 
 #include <iostream>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstring>
+#include <iterator>
 #include <list>
+#include <random>
 #include <stdexcept>
+#include <type_traits>
+#include <vector>
 
+#include "keysearch.hpp"
 #include "provider/abstractprovider.hpp"
 
 namespace fluxcore {
 
+/* Resident child pointers of a swizzled index node
+ *
+ * The pointers are only valid if <epoch> matches the epoch of the index instance that reads them. Ids stay the
+ * persistent representation, so the pointers never have to be unswizzled before the node gets written back.
+ */
+template <std::size_t n, bool enabled>
+struct SwizzleSlots {
+    std::uint64_t epoch;
+    void* slots[n];
+
+    void invalidate() {
+        epoch = 0;
+    }
+};
+
+template <std::size_t n>
+struct SwizzleSlots<n, false> {
+    void invalidate() {}
+};
+
+/* Returns a new epoch for swizzled indexes
+ *
+ * Epochs are unique per process and start at a random value, so pointers that were written to a persistent provider
+ * by an earlier process are never taken for valid ones.
+ */
+inline std::uint64_t nextSwizzleEpoch() {
+    static std::atomic<std::uint64_t> counter((static_cast<std::uint64_t>(std::random_device()()) << 32) | 1);
+    std::uint64_t epoch;
+
+    do {
+        epoch = counter.fetch_add(1);
+    } while (epoch == 0);
+
+    return epoch;
+}
+
+/* Size computations for the nodes of <Index>
+ *
+ * @K type of the keys
+ * @swizzle whether the nodes contain swizzled child pointers
+ *
+ * Nodes are aligned to cache lines: the header (and the swizzled pointers) come first, the keys start on the next
+ * cache line boundary and are followed by the children. The whole node is padded to a multiple of a cache line.
+ * <Index> checks this model against the real node layout at compile time.
+ */
+template <typename K, bool swizzle>
+struct IndexLayout {
+    static constexpr std::size_t lineSize = 64;
+    static constexpr std::size_t headerSize = 4 * sizeof(std::size_t);
+
+    static constexpr std::size_t roundUp(std::size_t x, std::size_t to) {
+        return (x + to - 1) / to * to;
+    }
+
+    /* Returns the size of a node with <n> keys in bytes
+     */
+    static constexpr std::size_t bytes(std::size_t n) {
+        return roundUp(
+                roundUp(roundUp((swizzle ? sizeof(std::uint64_t) + (n + 1) * sizeof(void*) : 0) + headerSize, lineSize) + n * sizeof(K), sizeof(std::size_t))
+                    + (n + 1) * sizeof(std::size_t),
+                lineSize);
+    }
+
+    /* Returns the largest number of keys per node that fits into <nodeBytes>
+     */
+    static constexpr std::size_t fanout(std::size_t nodeBytes) {
+        return fanoutFrom(nodeBytes, nodeBytes / (sizeof(K) + sizeof(std::size_t) + (swizzle ? sizeof(void*) : 0)));
+    }
+
+    private:
+        static constexpr std::size_t fanoutFrom(std::size_t nodeBytes, std::size_t n) {
+            return ((n == 0) || (bytes(n) <= nodeBytes)) ? n : fanoutFrom(nodeBytes, n - 1);
+        }
+};
+
 /* Index that maps keys to <std::size_t>
  *
  * @K type of the keys
  * @nodeSize number of stored keys per node
+ * @swizzle cache resident child pointers inside the nodes
  *
  * The index is implemented as a B+ tree. The <nodeSize> should be chosen according to the application. The bigger the number of stored records, the bigger should <nodeSize> be.
+ *
+ * With <swizzle> enabled, internal nodes additionally store direct pointers to their children, so a descent costs
+ * about one cache miss per level instead of one provider lookup per level. This requires that the provider does not
+ * move or evict node segments while the index is in use, otherwise <unswizzle> has to be called before that happens.
+ * Since reads write the pointers back to the nodes, this mode is meant for in-memory providers.
  */
-template <typename K, std::size_t nodeSize = 2>
+template <typename K, std::size_t nodeSize = 2, bool swizzle = false>
 class Index {
+    static_assert(nodeSize >= 2, "Nodes have to store at least 2 keys!");
+
+    struct Node;
+
     public:
+        typedef IndexLayout<K, swizzle> layout_t;
+
+        /* Size of a single node segment in bytes
+         */
+        static constexpr std::size_t nodeBytes = layout_t::bytes(nodeSize);
+
+        /* Bidirectional iterator over the records of an index
+         *
+         * The iterator walks the leaf chain using the sibling links, so moving to the next record never descends the
+         * tree again. It gets invalidated by every modification of the index.
+         */
+        class Iterator {
+            public:
+                Iterator() : owner(nullptr), leafId(0), leaf(nullptr), pos(0) {}
+
+                /* Returns the current record as (key, record) pair
+                 */
+                std::pair<K, std::size_t> operator*() const {
+                    return std::make_pair(leaf->keys[pos], leaf->children[pos]);
+                }
+
+                const K& key() const {
+                    return leaf->keys[pos];
+                }
+
+                std::size_t record() const {
+                    return leaf->children[pos];
+                }
+
+                Iterator& operator++() {
+                    ++pos;
+                    if (pos == leaf->filled) {
+                        if (leaf->right != 0) {
+                            load(leaf->right);
+                            pos = 0;
+                        } else {
+                            // stepping past the last leaf turns the iterator into <end>
+                            leafId = 0;
+                            leaf = nullptr;
+                            pos = 0;
+                        }
+                    }
+                    return *this;
+                }
+
+                Iterator& operator--() {
+                    if (leaf == nullptr) {
+                        leaf = owner->loadTail();
+                        leafId = owner->tailId;
+                        pos = leaf->filled;
+                    }
+                    if ((pos == 0) && (leaf->left != 0)) {
+                        load(leaf->left);
+                        pos = leaf->filled;
+                    }
+                    --pos;
+                    return *this;
+                }
+
+                bool operator==(const Iterator& other) const {
+                    return (leafId == other.leafId) && (pos == other.pos);
+                }
+
+                bool operator!=(const Iterator& other) const {
+                    return !(*this == other);
+                }
+
+            private:
+                friend class Index;
+
+                const Index* owner;
+                std::size_t leafId;
+                Node* leaf;
+                std::size_t pos;
+
+                /* Creates the <end> sentinel, it does not point to any leaf
+                 */
+                explicit Iterator(const Index* owner_) : owner(owner_), leafId(0), leaf(nullptr), pos(0) {}
+
+                Iterator(const Index* owner_, std::size_t leafId_, Node* leaf_, std::size_t pos_) : owner(owner_), leafId(leafId_), leaf(leaf_), pos(pos_) {}
+
+                void load(std::size_t id) {
+                    leafId = id;
+                    leaf = owner->loadNode(id);
+                }
+        };
+
         /* Creates new index
          *
          * @provider_ StorageProvider used to store the index data
          */
-        explicit Index(const provider_t& provider_) : provider(provider_) {
-            Segment s = provider->createSegment(sizeof(Node)); // waste some space to enable usage of block providers
+        explicit Index(const provider_t& provider_) : provider(provider_), structureVersion(nullptr), epoch(nextSwizzleEpoch()), rootCacheId(0), rootCache(nullptr), tailId(0), tailVersion(0) {
+            Segment s = createNodeSegment(); // waste some space to enable usage of block providers
             rootNode = static_cast<std::size_t*>(s.ptr());
+            structureVersion = rootNode + 1;
             *rootNode = 0;
+            *structureVersion = 0;
             id = s.id();
         }
 
@@ -39,9 +221,10 @@ class Index {
          *
          * Warning: Providing an illegal root ID leads to undefinied behavoir!
          */
-        Index(const provider_t& provider_, std::size_t id_) : provider(provider_), id(id_) {
-            Segment s = provider->getSegment(id);
+        Index(const provider_t& provider_, std::size_t id_) : provider(provider_), id(id_), epoch(nextSwizzleEpoch()), rootCacheId(0), rootCache(nullptr), tailId(0), tailVersion(0) {
+            Segment s = nodeSegment(id);
             rootNode = static_cast<std::size_t*>(s.ptr());
+            structureVersion = rootNode + 1;
         }
 
         /* Returns id of the root anchor
@@ -54,6 +237,17 @@ class Index {
             return id;
         }
 
+        /* Drops all swizzled pointers
+         *
+         * Has to be called before the provider moves or evicts node segments. Subsequent reads resolve the child ids
+         * again. This is a no-op for indexes without swizzling.
+         */
+        void unswizzle() {
+            epoch = nextSwizzleEpoch();
+            rootCacheId = 0;
+            rootCache = nullptr;
+        }
+
         /* Dumps index tree to a given <ostream>
          *
          * @os ostream that recieves the dump
@@ -83,24 +277,12 @@ class Index {
                 throw std::runtime_error("Index is empty!");
             }
 
-            std::size_t current = *rootNode;
-            const K* k = nullptr;
-            const std::size_t* record = nullptr;
-
-            while (current != 0) {
-                Segment s = provider->getSegment(current);
-                Node* n = static_cast<Node*>(s.ptr());
-
-                if (!n->leaf) {
-                    current = n->children[0];
-                } else {
-                    current = 0;
-                    k = &(n->keys[0]);
-                    record = &(n->children[0]);
-                }
+            Node* n = loadRoot();
+            while (!n->leaf) {
+                n = childNode(n, 0);
             }
 
-            return std::make_pair(*k, *record);
+            return std::make_pair(n->keys[0], n->children[0]);
         }
 
         /* Returns the last record in the index
@@ -112,24 +294,171 @@ class Index {
                 throw std::runtime_error("Index is empty!");
             }
 
+            Node* n = loadTail();
+
+            return std::make_pair(n->keys[n->filled - 1], n->children[n->filled - 1]);
+        }
+
+        /* Returns an iterator pointing to the first record
+         *
+         * For empty indexes this equals <end>.
+         */
+        Iterator begin() const {
+            if (*rootNode == 0) {
+                return end();
+            }
+
             std::size_t current = *rootNode;
-            const K* k = nullptr;
-            const std::size_t* record = nullptr;
+            Node* n = loadRoot();
+            while (!n->leaf) {
+                current = n->children[0];
+                n = childNode(n, 0);
+            }
 
-            while (current != 0) {
-                Segment s = provider->getSegment(current);
-                Node* n = static_cast<Node*>(s.ptr());
+            return (n->filled > 0) ? Iterator(this, current, n, 0) : end();
+        }
 
-                if (!n->leaf) {
-                    current = n->children[n->filled];
-                } else {
-                    current = 0;
-                    k = &(n->keys[n->filled - 1]);
-                    record = &(n->children[n->filled - 1]);
+        /* Returns an iterator pointing behind the last record
+         *
+         * This is a sentinel that does not touch any node, so it is cheap to call in loop conditions. The iterator can
+         * be decremented to get the last record, as long as the index is not empty.
+         */
+        Iterator end() const {
+            return Iterator(this);
+        }
+
+        /* Returns an iterator pointing to the first record with a key that is not less than <key>
+         *
+         * @key the search key
+         *
+         * @return iterator to the found record or <end> if all keys are less than <key>
+         *
+         * This is the entry point of range scans, which then cost O(log n + k).
+         */
+        Iterator lowerBound(const K& key) const {
+            if (*rootNode == 0) {
+                return end();
+            }
+
+            std::size_t current = *rootNode;
+            Node* n = loadRoot();
+            while (!n->leaf) {
+                std::size_t idx = n->findUpperIndex(key);
+                current = n->children[idx];
+                n = childNode(n, idx);
+            }
+
+            Iterator it(this, current, n, n->findLowerBound(key));
+            if (it.pos == n->filled) {
+                if (n->right == 0) {
+                    return end();
+                }
+                it.load(n->right);
+                it.pos = 0;
+            }
+            return it;
+        }
+
+        /* Finds the record of a given key
+         *
+         * @key the search key
+         *
+         * @return iterator to the record with the exact key or <end> if the key is not part of the index
+         */
+        Iterator find(const K& key) const {
+            Iterator it = lowerBound(key);
+
+            if ((it.leaf == nullptr) || (it.key() != key)) {
+                return end();
+            }
+
+            return it;
+        }
+
+        /* Builds the index bottom-up from sorted records
+         *
+         * @begin iterator to the first (key, record) pair
+         * @end iterator behind the last (key, record) pair
+         * @fillFactor fraction of the node capacity that gets used, will be clamped to the valid range of B+ tree nodes
+         *
+         * Warning: The index has to be empty and the input has to be sorted by unique keys, otherwise it leads to
+         * undefinied behavior!
+         *
+         * Leaves are packed from left to right and the internal levels get stacked on top of them, so the whole build
+         * runs in linear time without any splits. A <fillFactor> below 1 leaves space for later inserts.
+         */
+        template <typename Iter>
+        void bulkLoad(Iter begin, Iter end, double fillFactor = 1.0) {
+            if (*rootNode != 0) {
+                throw std::runtime_error("Index is not empty!");
+            }
+
+            std::size_t n = static_cast<std::size_t>(std::distance(begin, end));
+            if (n == 0) {
+                return;
+            }
+
+            std::size_t targetKeys = std::min(nodeSize, std::max(nodeSize / 2, static_cast<std::size_t>(fillFactor * nodeSize)));
+            targetKeys = std::max(targetKeys, static_cast<std::size_t>(1));
+
+            // Step 1: pack leaves, remember (first key, id) of each one
+            std::vector<std::pair<K, std::size_t>> level;
+            std::size_t nNodes = groupCount(n, targetKeys, nodeSize / 2);
+            level.reserve(nNodes);
+            Node* previous = nullptr;
+            for (std::size_t i = 0; i < nNodes; ++i) {
+                std::size_t count = n / nNodes + ((i < n % nNodes) ? 1 : 0);
+                Segment s = createNodeSegment();
+                memset(s.ptr(), 0, sizeof(Node));
+                Node* node = static_cast<Node*>(s.ptr());
+                node->leaf = true;
+
+                for (std::size_t j = 0; j < count; ++j, ++begin) {
+                    node->keys[j] = begin->first;
+                    node->children[j] = begin->second;
                 }
+                node->filled = count;
+
+                linkSiblings(previous, level, node, s.id());
+                level.push_back(std::make_pair(node->keys[0], s.id()));
+                previous = node;
+            }
+
+            // Step 2: stack internal levels until a single root is left
+            while (level.size() > 1) {
+                std::vector<std::pair<K, std::size_t>> upper;
+                std::size_t nChildren = level.size();
+                nNodes = groupCount(nChildren, targetKeys + 1, nodeSize / 2 + 1);
+                upper.reserve(nNodes);
+                previous = nullptr;
+                auto child = level.cbegin();
+
+                for (std::size_t i = 0; i < nNodes; ++i) {
+                    std::size_t count = nChildren / nNodes + ((i < nChildren % nNodes) ? 1 : 0);
+                    Segment s = createNodeSegment();
+                    memset(s.ptr(), 0, sizeof(Node));
+                    Node* node = static_cast<Node*>(s.ptr());
+                    node->leaf = false;
+
+                    K firstKey = child->first;
+                    node->children[0] = child->second;
+                    ++child;
+                    for (std::size_t j = 1; j < count; ++j, ++child) {
+                        node->keys[j - 1] = child->first;
+                        node->children[j] = child->second;
+                    }
+                    node->filled = count - 1;
+
+                    linkSiblings(previous, upper, node, s.id());
+                    upper.push_back(std::make_pair(firstKey, s.id()));
+                    previous = node;
+                }
+
+                level.swap(upper);
             }
 
-            return std::make_pair(*k, *record);
+            *rootNode = level.front().second;
+            rootCacheId = 0;
         }
 
         /* Inserts new key and record to index
@@ -138,10 +467,22 @@ class Index {
          * @record record that gets assoziated to the key
          *
          * Warning: The key has to be new and unique, otherwise it leads to undefinied behavior!
+         *
+         * Keys that are greater than all existing keys get appended to the cached right-most leaf without descending
+         * the tree. If that leaf is full, a new leaf is started instead of splitting it in half, so append-only
+         * workloads end up with completely packed leaves.
          */
         void insert(const K& key, const std::size_t record) {
+            if (*rootNode != 0) {
+                Node* tail = loadTail();
+                if (tail->keys[tail->filled - 1] < key) {
+                    append(tail, key, record);
+                    return;
+                }
+            }
+
             // Step 1: walk down and find insert point
-            std::list<std::size_t> history = walkDown(key);
+            std::list<std::pair<std::size_t, Node*>> history = walkDown(key);
 
             // Step 2: push data up to the root
             auto step = getParentNode(history);
@@ -152,8 +493,8 @@ class Index {
             // rise up and look for space
             while (std::get<1>(step)->full()) {
                 // prepate 2 new nodes
-                Segment s1 = provider->createSegment(sizeof(Node));
-                Segment s2 = provider->createSegment(sizeof(Node));
+                Segment s1 = createNodeSegment();
+                Segment s2 = createNodeSegment();
                 memset(s1.ptr(), 0, sizeof(Node));
                 memset(s2.ptr(), 0, sizeof(Node));
                 Node* n1 = static_cast<Node*>(s1.ptr());
@@ -167,19 +508,22 @@ class Index {
 
                 // update neigbors
                 if (n1->left != 0) {
-                    Segment tmpS = provider->getSegment(n1->left);
+                    Segment tmpS = nodeSegment(n1->left);
                     Node* tmpN = static_cast<Node*>(tmpS.ptr());
                     tmpN->right = s1.id();
                 }
                 if (n2->right != 0) {
-                    Segment tmpS = provider->getSegment(n2->right);
+                    Segment tmpS = nodeSegment(n2->right);
                     Node* tmpN = static_cast<Node*>(tmpS.ptr());
                     tmpN->left = s2.id();
                 }
 
                 // split, free, next
                 stepKey = step.second->split(stepKey, n1, n2, child1, child2);
-                provider->freeSegment(step.first.id());
+                if (step.first.id() == tailId) {
+                    tailId = 0;
+                }
+                freeNodeSegment(step.first.id());
                 step = getParentNode(history);
                 child1 = s1.id();
                 child2 = s2.id();
@@ -189,6 +533,51 @@ class Index {
             step.second->add(stepKey, child1, child2);
         }
 
+        /* Inserts a batch of records
+         *
+         * @begin iterator to the first (key, record) pair
+         * @end iterator behind the last (key, record) pair
+         *
+         * Warning: The input has to be sorted by keys and all keys have to be new and unique, otherwise it leads to
+         * undefinied behavior!
+         *
+         * Records behind the current last key are copied into the right-most leaf in blocks, so appending a sorted
+         * batch costs about one copy per record plus one new leaf per <nodeSize> records. Other records are inserted
+         * one by one.
+         */
+        template <typename Iter>
+        void insertSorted(Iter begin, Iter end) {
+            while (begin != end) {
+                if (*rootNode == 0) {
+                    insert(begin->first, begin->second);
+                    ++begin;
+                    continue;
+                }
+
+                Node* tail = loadTail();
+                if (!(tail->keys[tail->filled - 1] < begin->first)) {
+                    insert(begin->first, begin->second);
+                    ++begin;
+                    continue;
+                }
+
+                // the rest of the input is an append
+                while (begin != end) {
+                    if (tail->full()) {
+                        append(tail, begin->first, begin->second);
+                        ++begin;
+                        tail = loadNode(tailId);
+                    }
+
+                    for (; (begin != end) && !tail->full(); ++begin) {
+                        tail->keys[tail->filled] = begin->first;
+                        tail->children[tail->filled] = begin->second;
+                        ++tail->filled;
+                    }
+                }
+            }
+        }
+
         /* Erases exisiting key and assoziated record from index
          *
          * @key the key that should be removed
@@ -196,8 +585,11 @@ class Index {
          * Warning: The key has to exist, otherwise it leads to undefinied behavior!
          */
         void erase(const K& key) {
+            // merges may free the right-most leaf
+            tailId = 0;
+
             // Step 1: find leaf
-            std::list<std::size_t> history = walkDown(key);
+            std::list<std::pair<std::size_t, Node*>> history = walkDown(key);
 
             // Step 2: delete until tree is happy
             auto step = getParentNode(history);
@@ -209,7 +601,7 @@ class Index {
 
                 // find sibling to re-distribute
                 if ((step.second->left != 0) && (separator = parentStep.second->getSeparator(step.second->left, step.first.id()))) {
-                    Segment s = provider->getSegment(step.second->left);
+                    Segment s = nodeSegment(step.second->left);
                     Node* n = static_cast<Node*>(s.ptr());
 
                     if (step.second->filled + n->filled >= nodeSize) {
@@ -238,6 +630,7 @@ class Index {
                             // remove element from left node
                             memset(&n->keys[n->filled - 1], 0, sizeof(K));
                             n->children[n->filled] = 0;
+                            n->invalidate();
                             --n->filled;
 
                             // add element to right node
@@ -251,16 +644,16 @@ class Index {
                         n->mergeWith(step.second, *separator);
                         n->right = step.second->right;
                         if (step.second->right != 0) {
-                            Segment tmpS = provider->getSegment(step.second->right);
+                            Segment tmpS = nodeSegment(step.second->right);
                             Node* tmpN = static_cast<Node*>(tmpS.ptr());
                             tmpN->left = s.id();
                         }
-                        provider->freeSegment(step.first.id());
+                        freeNodeSegment(step.first.id());
                         parentStep.second->removeByKeyRight(*separator);
                     }
                 } else {
                     separator = parentStep.second->getSeparator(step.first.id(), step.second->right);
-                    Segment s = provider->getSegment(step.second->right);
+                    Segment s = nodeSegment(step.second->right);
                     Node* n = static_cast<Node*>(s.ptr());
 
                     if (step.second->filled + n->filled >= nodeSize) {
@@ -292,6 +685,7 @@ class Index {
                             // add element to right node
                             step.second->keys[step.second->filled] = *separator;
                             step.second->children[step.second->filled + 1] = c1;
+                            step.second->invalidate();
                             ++step.second->filled;
 
                             // fix separator
@@ -302,11 +696,11 @@ class Index {
                         step.second->mergeWith(n, *separator);
                         step.second->right = n->right;
                         if (n->right != 0) {
-                            Segment tmpS = provider->getSegment(n->right);
+                            Segment tmpS = nodeSegment(n->right);
                             Node* tmpN = static_cast<Node*>(tmpS.ptr());
                             tmpN->left = step.first.id();
                         }
-                        provider->freeSegment(s.id());
+                        freeNodeSegment(s.id());
                         parentStep.second->removeByKeyRight(*separator);
                     }
                 }
@@ -315,9 +709,10 @@ class Index {
             }
 
             // cleanup root
-            if (step.second->filled < nodeSize / 2) {
-                *rootNode = step.second->children[0];
-                provider->freeSegment(step.first.id());
+            if (step.second->filled == 0) {
+                *rootNode = step.second->leaf ? 0 : step.second->children[0];
+                rootCacheId = 0;
+                freeNodeSegment(step.first.id());
             }
         }
 
@@ -326,12 +721,12 @@ class Index {
          *
          * Parent nodes are not stored because the can be extracted from the walk down history
          */
-        struct Node {
+        struct alignas(layout_t::lineSize) Node : SwizzleSlots<nodeSize + 1, swizzle> {
             bool leaf;
             std::size_t left;
             std::size_t right;
             std::size_t filled;
-            K keys[nodeSize];
+            alignas(layout_t::lineSize) K keys[nodeSize];
             std::size_t children[nodeSize + 1];
 
             /* checks if node is full
@@ -363,15 +758,15 @@ class Index {
              * @child2 right child for internal nodes, ignored for leaf nodes
              */
             void add(const K& key, std::size_t child1, std::size_t child2) {
-                std::size_t i;
+                std::size_t i = findUpperIndex(key);
 
-                for (i = filled; (i > 0) && (keys[i - 1] > key); --i) {
-                    keys[i] = keys[i - 1];
-                    if (leaf) {
-                        children[i] = children[i - 1];
-                    } else {
-                        children[i + 1] = children[i];
-                    }
+                this->invalidate();
+
+                std::copy_backward(keys + i, keys + filled, keys + filled + 1);
+                if (leaf) {
+                    std::copy_backward(children + i, children + filled, children + filled + 1);
+                } else {
+                    std::copy_backward(children + i + 1, children + filled + 1, children + filled + 2);
                 }
 
                 keys[i] = key;
@@ -384,42 +779,31 @@ class Index {
 
             /* Remove key and the left child
              */
-            void removeByKeyLeft(const K& key) {
-                std::size_t idx = 0;
+            void removeByKeyLeft(const K key) {
+                std::size_t i = findLowerBound(key);
 
-                for (std::size_t i = 0; i < filled; ++i) {
-                    if (keys[i] == key) {
-                        memset(&keys[i], 0, sizeof(K));
-                        children[i] = 0;
-                    } else {
-                        keys[idx] = keys[i];
-                        children[idx] = children[i];
-                        ++idx;
-                    }
-                }
+                this->invalidate();
+
+                std::copy(keys + i + 1, keys + filled, keys + i);
+                std::copy(children + i + 1, children + filled + 1, children + i);
 
                 memset(&keys[filled - 1], 0, sizeof(K));
-                children[idx] = children[filled];
+                children[filled] = 0;
                 --filled;
             }
 
             /* Remove key and the right child
              */
-            void removeByKeyRight(const K& key) {
-                std::size_t idx = 0;
+            void removeByKeyRight(const K key) {
+                std::size_t i = findLowerBound(key);
 
-                for (std::size_t i = 0; i < filled; ++i) {
-                    if (keys[i] == key) {
-                        memset(&keys[i], 0, sizeof(K));
-                        children[i + 1] = 0;
-                    } else {
-                        keys[idx] = keys[i];
-                        children[idx + 1] = children[i + 1];
-                        ++idx;
-                    }
-                }
+                this->invalidate();
+
+                std::copy(keys + i + 1, keys + filled, keys + i);
+                std::copy(children + i + 2, children + filled + 1, children + i + 1);
 
                 memset(&keys[filled - 1], 0, sizeof(K));
+                children[filled] = 0;
                 --filled;
             }
 
@@ -432,6 +816,8 @@ class Index {
                 std::size_t idxChildren = filled;
                 std::size_t idxKeys = filled;
 
+                this->invalidate();
+
                 if (!leaf) {
                     keys[idxKeys] = separator;
                     ++idxChildren;
@@ -541,7 +927,7 @@ class Index {
                 }
 
                 // second node
-                for (std::size_t i = 0; i < nodeSize / 2; ++i) {
+                for (std::size_t i = 0; i < nodeSize - nodeSize / 2; ++i) {
                     if (toCheck &&
                             ((idx == nodeSize) || (keys[idx] > key))) {
                         // add key and value
@@ -573,26 +959,34 @@ class Index {
 
                 // set node attributes
                 n1->filled = nodeSize / 2 + (leaf ? 1 : 0);
-                n2->filled = nodeSize / 2;
+                n2->filled = nodeSize - nodeSize / 2;
 
                 return median;
             }
 
-            std::pair<std::size_t, const K*> findUpperAnchor(const K& key) const {
-                std::size_t idx = filled;
-                const K* k = nullptr;
+            /* Returns the position of the first key that is greater than <key>
+             *
+             * For internal nodes this is the position of the child that covers <key>.
+             */
+            std::size_t findUpperIndex(const K& key) const {
+                return KeySearch<K>::upper(keys, filled, key);
+            }
 
-                for (std::size_t i = 0; i < filled; ++i) {
-                    if (keys[i] > key) {
-                        idx = i;
-                        k = &keys[i];
-                        break;
-                    }
-                }
+            std::pair<std::size_t, const K*> findUpperAnchor(const K& key) const {
+                std::size_t idx = findUpperIndex(key);
+                const K* k = (idx < filled) ? &keys[idx] : nullptr;
 
                 return std::make_pair(children[idx], k);
             }
 
+            /* Returns the position of the first key that is not less than <key>
+             *
+             * The result equals <filled> if all keys are less than <key>.
+             */
+            std::size_t findLowerBound(const K& key) const {
+                return KeySearch<K>::lower(keys, filled, key);
+            }
+
             std::pair<std::size_t, const K*> findLowerAnchor(const K& key) const {
                 std::size_t idx = 0;
                 const K* k = nullptr;
@@ -609,9 +1003,182 @@ class Index {
             }
         };
 
+        static_assert(sizeof(Node) == layout_t::bytes(nodeSize), "IndexLayout does not match the node layout!");
+
         provider_t provider;
         std::size_t* rootNode;
+        std::size_t* structureVersion; // stored behind the root id, counts created and freed nodes of all instances
         std::size_t id;
+        std::uint64_t epoch;
+        mutable std::size_t rootCacheId;
+        mutable Node* rootCache;
+        mutable std::size_t tailId;
+        mutable std::size_t tailVersion;
+
+        /* Creates a segment for a node or the root anchor
+         *
+         * Nodes are referenced by raw pointers across calls, so their segments are exempted from pin counting, see
+         * <AbstractProvider::keepResident>.
+         */
+        Segment createNodeSegment() {
+            Segment s = provider->createSegment(sizeof(Node));
+            provider->keepResident(s.id());
+            if (structureVersion != nullptr) {
+                ++*structureVersion;
+            }
+            return s;
+        }
+
+        /* Frees the segment of a node, see <createNodeSegment>
+         */
+        void freeNodeSegment(std::size_t nodeId) {
+            provider->freeSegment(nodeId);
+            ++*structureVersion;
+        }
+
+        /* Returns the segment of a node or the root anchor, see <createNodeSegment>
+         */
+        Segment nodeSegment(std::size_t nodeId) const {
+            Segment s = provider->getSegment(nodeId);
+            provider->keepResident(nodeId);
+            return s;
+        }
+
+        /* Resolves a node id using the provider
+         */
+        Node* loadNode(std::size_t nodeId) const {
+            Segment s = nodeSegment(nodeId);
+            return static_cast<Node*>(s.ptr());
+        }
+
+        /* Returns the root node, the index must not be empty
+         */
+        Node* loadRoot() const {
+            if (!swizzle) {
+                return loadNode(*rootNode);
+            }
+
+            if (rootCacheId != *rootNode) {
+                rootCache = loadNode(*rootNode);
+                rootCacheId = *rootNode;
+            }
+            return rootCache;
+        }
+
+        /* Returns the right-most leaf, the index must not be empty
+         *
+         * The id of the leaf is cached until a split or merge frees it. Other instances on the same root may change
+         * the tree as well, so the cache is only trusted while no instance created or freed a node since, see
+         * <structureVersion>. The right-most leaf can only be replaced by creating or freeing one.
+         */
+        Node* loadTail() const {
+            if ((tailId != 0) && (tailVersion == *structureVersion)) {
+                return loadNode(tailId);
+            }
+
+            std::size_t current = *rootNode;
+            Node* n = loadRoot();
+            while (!n->leaf) {
+                current = n->children[n->filled];
+                n = childNode(n, n->filled);
+            }
+
+            tailId = current;
+            tailVersion = *structureVersion;
+            return n;
+        }
+
+        /* Appends a record with a key that is greater than all existing keys to the right-most leaf <tail>
+         *
+         * A full <tail> is not split in half (which would leave it half empty forever) but kept as it is, the record
+         * starts a new right-most leaf. Full internal nodes on the right-most path are split the same way: only their
+         * last child moves to the new node, together with the new separator.
+         */
+        void append(Node* tail, const K& key, const std::size_t record) {
+            if (!tail->full()) {
+                tail->keys[tail->filled] = key;
+                tail->children[tail->filled] = record;
+                ++tail->filled;
+                return;
+            }
+
+            // Step 1: walk down the right-most path, drop the leaf itself
+            std::list<std::pair<std::size_t, Node*>> history = walkDown(key);
+            history.pop_front();
+
+            // Step 2: start a new leaf
+            Segment s = createNodeSegment();
+            memset(s.ptr(), 0, sizeof(Node));
+            Node* n = static_cast<Node*>(s.ptr());
+            n->leaf = true;
+            n->keys[0] = key;
+            n->children[0] = record;
+            n->filled = 1;
+            n->left = tailId;
+            tail->right = s.id();
+
+            // Step 3: push the separator up, split 100/0 on the way
+            K stepKey = key;
+            std::size_t child1 = tailId;
+            std::size_t child2 = s.id();
+            tailId = s.id();
+
+            auto step = getParentNode(history);
+            while (step.second->full()) {
+                Segment sNew = createNodeSegment();
+                memset(sNew.ptr(), 0, sizeof(Node));
+                Node* nNew = static_cast<Node*>(sNew.ptr());
+                Node* full = step.second;
+                K pushed = full->keys[nodeSize - 1];
+
+                nNew->leaf = false;
+                nNew->keys[0] = stepKey;
+                nNew->children[0] = full->children[nodeSize];
+                nNew->children[1] = child2;
+                nNew->filled = 1;
+                nNew->left = step.first.id();
+                full->right = sNew.id();
+
+                full->invalidate();
+                memset(&full->keys[nodeSize - 1], 0, sizeof(K));
+                full->children[nodeSize] = 0;
+                --full->filled;
+
+                stepKey = pushed;
+                child1 = step.first.id();
+                child2 = sNew.id();
+                step = getParentNode(history);
+            }
+
+            step.second->add(stepKey, child1, child2);
+
+            // the nodes created above do not invalidate the new tail
+            tailVersion = *structureVersion;
+        }
+
+        /* Returns the i-th child of an internal node
+         */
+        Node* childNode(Node* n, std::size_t i) const {
+            return childNode(n, i, std::integral_constant<bool, swizzle>());
+        }
+
+        Node* childNode(Node* n, std::size_t i, std::false_type) const {
+            return loadNode(n->children[i]);
+        }
+
+        Node* childNode(Node* n, std::size_t i, std::true_type) const {
+            if (n->epoch != epoch) {
+                memset(n->slots, 0, sizeof(n->slots));
+                n->epoch = epoch;
+            }
+
+            Node* child = static_cast<Node*>(n->slots[i]);
+            if (child == nullptr) {
+                child = loadNode(n->children[i]);
+                n->slots[i] = child;
+            }
+            return child;
+        }
 
         /* Dumps a node including children to a given ostream
          *
@@ -621,7 +1188,7 @@ class Index {
          * The function is implemented recursive, so it's only supposed to work on a valid tree. The dumped data contains newlines (<std::endl>).
          */
         void dumpNode(std::size_t id, std::ostream& os) {
-            Segment s = provider->getSegment(id);
+            Segment s = nodeSegment(id);
             Node* n = static_cast<Node*>(s.ptr());
 
             os  << "--------" << std::endl
@@ -672,45 +1239,90 @@ class Index {
             }
         }
 
-        std::list<std::size_t> walkDown(const K& key) {
-            std::size_t current = *rootNode;
-            std::list<std::size_t> history;
-            bool foundLeaf = false;
+        /* Computes the number of nodes a level of a bulk load gets split into
+         *
+         * @n number of entries (keys for leaves, children for internal nodes) of the level
+         * @target preferred number of entries per node
+         * @minimum minimal number of entries per node
+         *
+         * The entries get distributed evenly, so every node stays between <minimum> and the node capacity. Only a
+         * single node (the root) may have less than <minimum> entries.
+         */
+        static std::size_t groupCount(std::size_t n, std::size_t target, std::size_t minimum) {
+            std::size_t groups = (n + target - 1) / target;
 
-            while (!foundLeaf && (current != 0)) {
-                Segment s = provider->getSegment(current);
-                Node* n = static_cast<Node*>(s.ptr());
-                history.push_front(current);
-                current = std::get<0>(n->findUpperAnchor(key));
-                foundLeaf = n->leaf;
+            while ((groups > 1) && (n / groups < minimum)) {
+                --groups;
+            }
+
+            return groups;
+        }
+
+        /* Links a new node to its left neighbor during a bulk load
+         */
+        static void linkSiblings(Node* previous, const std::vector<std::pair<K, std::size_t>>& level, Node* node, std::size_t id) {
+            if (previous != nullptr) {
+                previous->right = id;
+                node->left = level.back().second;
+            }
+        }
+
+        std::list<std::pair<std::size_t, Node*>> walkDown(const K& key) {
+            std::list<std::pair<std::size_t, Node*>> history;
+
+            if (*rootNode == 0) {
+                return history;
+            }
+
+            std::size_t current = *rootNode;
+            Node* n = loadRoot();
+            history.push_front(std::make_pair(current, n));
+            while (!n->leaf) {
+                std::size_t idx = n->findUpperIndex(key);
+                current = n->children[idx];
+                n = childNode(n, idx);
+                history.push_front(std::make_pair(current, n));
             }
 
             return history;
         }
 
-        std::pair<Segment, Node*> getParentNode(std::list<std::size_t>& history) {
+        std::pair<Segment, Node*> getParentNode(std::list<std::pair<std::size_t, Node*>>& history) {
             if (history.empty()) {
                 // new root node
-                Segment s = provider->createSegment(sizeof(Node));
+                Segment s = createNodeSegment();
                 memset(s.ptr(), 0, sizeof(Node));
                 Node* n = static_cast<Node*>(s.ptr());
                 if (*rootNode == 0) {
                     n->leaf = true;
                 }
                 *rootNode = s.id();
+                rootCacheId = 0;
 
                 return std::make_pair(std::move(s), std::move(n));
             } else {
-                std::size_t last = *history.begin();
+                std::pair<std::size_t, Node*> last = history.front();
                 history.pop_front();
-                Segment s = provider->getSegment(last);
-                Node* n = static_cast<Node*>(s.ptr());
 
-                return std::make_pair(std::move(s), std::move(n));
+                return std::make_pair(Segment(last.first, last.second, sizeof(Node)), last.second);
             }
         }
 };
 
+template <typename K, std::size_t nodeSize, bool swizzle>
+constexpr std::size_t Index<K, nodeSize, swizzle>::nodeBytes;
+
+/* Index configured by the size of its nodes in bytes
+ *
+ * @K type of the keys
+ * @nodeBytes upper limit of the node size, e.g. 64 for a cache line or 4096 for a page
+ * @swizzle cache resident child pointers inside the nodes
+ *
+ * The number of keys per node gets computed at compile time. Choosing a multiple of the page size makes every node
+ * segment of a file backed provider map one-to-one onto pages.
+ */
+template <typename K, std::size_t nodeBytes, bool swizzle = false>
+using SizedIndex = Index<K, IndexLayout<K, swizzle>::fanout(nodeBytes), swizzle>;
 
 }
 
@@ -0,0 +1,176 @@
+#include "keysearch.hpp"
+
+#include <atomic>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FLUXCORE_KEYSEARCH_X86
+#include <immintrin.h>
+#endif
+
+using namespace fluxcore;
+
+// Unsigned keys are compared as signed ones after flipping the sign bit (<bias>), because SSE/AVX only provide signed
+// compares. <less> swaps the operands, so the same kernel counts keys < key instead of keys > key.
+
+template <typename T>
+static std::size_t countScalar(const T* keys, std::size_t n, T key, T bias, bool less) {
+    std::size_t count = 0;
+    key ^= bias;
+
+    for (std::size_t i = 0; i < n; ++i) {
+        T k = keys[i] ^ bias;
+        count += less ? (k < key) : (k > key);
+    }
+
+    return count;
+}
+
+static std::size_t count64Scalar(const std::int64_t* keys, std::size_t n, std::int64_t key, std::int64_t bias, bool less) {
+    return countScalar(keys, n, key, bias, less);
+}
+
+static std::size_t count32Scalar(const std::int32_t* keys, std::size_t n, std::int32_t key, std::int32_t bias, bool less) {
+    return countScalar(keys, n, key, bias, less);
+}
+
+#ifdef FLUXCORE_KEYSEARCH_X86
+
+__attribute__((target("avx2")))
+static std::size_t count64AVX2(const std::int64_t* keys, std::size_t n, std::int64_t key, std::int64_t bias, bool less) {
+    const __m256i b = _mm256_set1_epi64x(bias);
+    const __m256i k = _mm256_xor_si256(_mm256_set1_epi64x(key), b);
+    std::size_t count = 0;
+    std::size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), b);
+        __m256i m = less ? _mm256_cmpgt_epi64(k, v) : _mm256_cmpgt_epi64(v, k);
+        count += static_cast<std::size_t>(__builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(m))));
+    }
+
+    return count + countScalar(keys + i, n - i, key, bias, less);
+}
+
+__attribute__((target("avx2")))
+static std::size_t count32AVX2(const std::int32_t* keys, std::size_t n, std::int32_t key, std::int32_t bias, bool less) {
+    const __m256i b = _mm256_set1_epi32(bias);
+    const __m256i k = _mm256_xor_si256(_mm256_set1_epi32(key), b);
+    std::size_t count = 0;
+    std::size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), b);
+        __m256i m = less ? _mm256_cmpgt_epi32(k, v) : _mm256_cmpgt_epi32(v, k);
+        count += static_cast<std::size_t>(__builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(m))));
+    }
+
+    return count + countScalar(keys + i, n - i, key, bias, less);
+}
+
+__attribute__((target("sse4.2")))
+static std::size_t count64SSE42(const std::int64_t* keys, std::size_t n, std::int64_t key, std::int64_t bias, bool less) {
+    const __m128i b = _mm_set1_epi64x(bias);
+    const __m128i k = _mm_xor_si128(_mm_set1_epi64x(key), b);
+    std::size_t count = 0;
+    std::size_t i = 0;
+
+    for (; i + 2 <= n; i += 2) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), b);
+        __m128i m = less ? _mm_cmpgt_epi64(k, v) : _mm_cmpgt_epi64(v, k);
+        count += static_cast<std::size_t>(__builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(m))));
+    }
+
+    return count + countScalar(keys + i, n - i, key, bias, less);
+}
+
+__attribute__((target("sse4.2")))
+static std::size_t count32SSE42(const std::int32_t* keys, std::size_t n, std::int32_t key, std::int32_t bias, bool less) {
+    const __m128i b = _mm_set1_epi32(bias);
+    const __m128i k = _mm_xor_si128(_mm_set1_epi32(key), b);
+    std::size_t count = 0;
+    std::size_t i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), b);
+        __m128i m = less ? _mm_cmpgt_epi32(k, v) : _mm_cmpgt_epi32(v, k);
+        count += static_cast<std::size_t>(__builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(m))));
+    }
+
+    return count + countScalar(keys + i, n - i, key, bias, less);
+}
+
+#endif
+
+typedef std::size_t (*count64_t)(const std::int64_t*, std::size_t, std::int64_t, std::int64_t, bool);
+typedef std::size_t (*count32_t)(const std::int32_t*, std::size_t, std::int32_t, std::int32_t, bool);
+
+static std::size_t count64Resolve(const std::int64_t* keys, std::size_t n, std::int64_t key, std::int64_t bias, bool less);
+static std::size_t count32Resolve(const std::int32_t* keys, std::size_t n, std::int32_t key, std::int32_t bias, bool less);
+
+// constant initialized, so the kernels can be used during static initialization as well
+static std::atomic<count64_t> count64(count64Resolve);
+static std::atomic<count32_t> count32(count32Resolve);
+
+static void resolveKernels() {
+    count64_t k64 = count64Scalar;
+    count32_t k32 = count32Scalar;
+
+#ifdef FLUXCORE_KEYSEARCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        k64 = count64AVX2;
+        k32 = count32AVX2;
+    } else if (__builtin_cpu_supports("sse4.2")) {
+        k64 = count64SSE42;
+        k32 = count32SSE42;
+    }
+#endif
+
+    count64.store(k64, std::memory_order_relaxed);
+    count32.store(k32, std::memory_order_relaxed);
+}
+
+static std::size_t count64Resolve(const std::int64_t* keys, std::size_t n, std::int64_t key, std::int64_t bias, bool less) {
+    resolveKernels();
+    return count64.load(std::memory_order_relaxed)(keys, n, key, bias, less);
+}
+
+static std::size_t count32Resolve(const std::int32_t* keys, std::size_t n, std::int32_t key, std::int32_t bias, bool less) {
+    resolveKernels();
+    return count32.load(std::memory_order_relaxed)(keys, n, key, bias, less);
+}
+
+static constexpr std::int64_t bias64 = static_cast<std::int64_t>(UINT64_C(1) << 63);
+static constexpr std::int32_t bias32 = static_cast<std::int32_t>(UINT32_C(1) << 31);
+
+std::size_t fluxcore::countGreater(const std::int64_t* keys, std::size_t n, std::int64_t key) {
+    return count64.load(std::memory_order_relaxed)(keys, n, key, 0, false);
+}
+
+std::size_t fluxcore::countGreater(const std::uint64_t* keys, std::size_t n, std::uint64_t key) {
+    return count64.load(std::memory_order_relaxed)(reinterpret_cast<const std::int64_t*>(keys), n, static_cast<std::int64_t>(key), bias64, false);
+}
+
+std::size_t fluxcore::countGreater(const std::int32_t* keys, std::size_t n, std::int32_t key) {
+    return count32.load(std::memory_order_relaxed)(keys, n, key, 0, false);
+}
+
+std::size_t fluxcore::countGreater(const std::uint32_t* keys, std::size_t n, std::uint32_t key) {
+    return count32.load(std::memory_order_relaxed)(reinterpret_cast<const std::int32_t*>(keys), n, static_cast<std::int32_t>(key), bias32, false);
+}
+
+std::size_t fluxcore::countLess(const std::int64_t* keys, std::size_t n, std::int64_t key) {
+    return count64.load(std::memory_order_relaxed)(keys, n, key, 0, true);
+}
+
+std::size_t fluxcore::countLess(const std::uint64_t* keys, std::size_t n, std::uint64_t key) {
+    return count64.load(std::memory_order_relaxed)(reinterpret_cast<const std::int64_t*>(keys), n, static_cast<std::int64_t>(key), bias64, true);
+}
+
+std::size_t fluxcore::countLess(const std::int32_t* keys, std::size_t n, std::int32_t key) {
+    return count32.load(std::memory_order_relaxed)(keys, n, key, 0, true);
+}
+
+std::size_t fluxcore::countLess(const std::uint32_t* keys, std::size_t n, std::uint32_t key) {
+    return count32.load(std::memory_order_relaxed)(reinterpret_cast<const std::int32_t*>(keys), n, static_cast<std::int32_t>(key), bias32, true);
+}
@@ -0,0 +1,103 @@
+#ifndef FLUXCORE_KEYSEARCH_HPP
+#define FLUXCORE_KEYSEARCH_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace fluxcore {
+
+/* Vectorized counting kernels for sorted key arrays
+ *
+ * <countGreater> returns the number of keys that are greater than <key>, <countLess> the number of keys that are less
+ * than <key>. The implementation (AVX2, SSE4.2 or scalar) gets selected at runtime on first use.
+ */
+std::size_t countGreater(const std::int64_t* keys, std::size_t n, std::int64_t key);
+std::size_t countGreater(const std::uint64_t* keys, std::size_t n, std::uint64_t key);
+std::size_t countGreater(const std::int32_t* keys, std::size_t n, std::int32_t key);
+std::size_t countGreater(const std::uint32_t* keys, std::size_t n, std::uint32_t key);
+
+std::size_t countLess(const std::int64_t* keys, std::size_t n, std::int64_t key);
+std::size_t countLess(const std::uint64_t* keys, std::size_t n, std::uint64_t key);
+std::size_t countLess(const std::int32_t* keys, std::size_t n, std::int32_t key);
+std::size_t countLess(const std::uint32_t* keys, std::size_t n, std::uint32_t key);
+
+/* Search in sorted key arrays, used for the nodes of <Index>
+ *
+ * @K type of the keys
+ *
+ * <upper> returns the position of the first key greater than <key>, <lower> the position of the first key that is
+ * not less than <key>. Both return <n> if there is no such key.
+ *
+ * Integral keys of 4 or 8 bytes get counted with SIMD compares, which is branch-free and faster than a scalar scan for
+ * small arrays. Wider arrays are narrowed down to a window of at most <windowSize> keys with a branch-free binary
+ * search first. All other key types use scalar comparisons.
+ */
+template <typename K, bool vectorized = std::is_integral<K>::value && ((sizeof(K) == 4) || (sizeof(K) == 8))>
+struct KeySearch {
+    static std::size_t upper(const K* keys, std::size_t n, const K& key) {
+        if (n > 16) {
+            return static_cast<std::size_t>(std::upper_bound(keys, keys + n, key) - keys);
+        }
+
+        std::size_t i = 0;
+        while ((i < n) && !(keys[i] > key)) {
+            ++i;
+        }
+        return i;
+    }
+
+    static std::size_t lower(const K* keys, std::size_t n, const K& key) {
+        if (n > 16) {
+            return static_cast<std::size_t>(std::lower_bound(keys, keys + n, key) - keys);
+        }
+
+        std::size_t i = 0;
+        while ((i < n) && (keys[i] < key)) {
+            ++i;
+        }
+        return i;
+    }
+};
+
+template <typename K>
+struct KeySearch<K, true> {
+    static constexpr std::size_t windowSize = 32;
+
+    typedef typename std::conditional<sizeof(K) == 8,
+            typename std::conditional<std::is_signed<K>::value, std::int64_t, std::uint64_t>::type,
+            typename std::conditional<std::is_signed<K>::value, std::int32_t, std::uint32_t>::type>::type fixed_t;
+
+    static std::size_t upper(const K* keys, std::size_t n, const K& key) {
+        const fixed_t* base = reinterpret_cast<const fixed_t*>(keys);
+        const fixed_t k = static_cast<fixed_t>(key);
+
+        // everything in front of base is <= key, everything behind base + n is > key
+        while (n > windowSize) {
+            std::size_t half = n / 2;
+            base = (base[half] <= k) ? base + half : base;
+            n -= half;
+        }
+
+        return static_cast<std::size_t>(base - reinterpret_cast<const fixed_t*>(keys)) + n - countGreater(base, n, k);
+    }
+
+    static std::size_t lower(const K* keys, std::size_t n, const K& key) {
+        const fixed_t* base = reinterpret_cast<const fixed_t*>(keys);
+        const fixed_t k = static_cast<fixed_t>(key);
+
+        // everything in front of base is < key, everything behind base + n is >= key
+        while (n > windowSize) {
+            std::size_t half = n / 2;
+            base = (base[half] < k) ? base + half : base;
+            n -= half;
+        }
+
+        return static_cast<std::size_t>(base - reinterpret_cast<const fixed_t*>(keys)) + countLess(base, n, k);
+    }
+};
+
+}
+
+#endif
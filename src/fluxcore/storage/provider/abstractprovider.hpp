@@ -3,13 +3,26 @@
 
 #include <cstddef>
 #include <memory>
+#include <utility>
 
 #include "segment.hpp"
 
 namespace fluxcore {
 
+/* Base class of all storage providers
+ *
+ * Segments returned by a provider start at an address that is a multiple of <segmentAlignment>, so data structures
+ * can align their hot fields to cache lines.
+ *
+ * <createSegment> and <getSegment> pin the returned segment. Providers that evict segments from memory (see
+ * <BufferPoolProvider>) keep a segment in place as long as it has pins, all others ignore pins. Code that never calls
+ * <unpinSegment> keeps its segments resident and should say so with <keepResident>, <SegmentPin> releases the pin
+ * automatically.
+ */
 class AbstractProvider {
     public:
+        static constexpr std::size_t segmentAlignment = 64;
+
         AbstractProvider() = default;
         AbstractProvider(const AbstractProvider&) = delete;
         virtual ~AbstractProvider() {}
@@ -17,10 +30,119 @@ class AbstractProvider {
         virtual Segment getSegment(std::size_t id) = 0;
         virtual Segment createSegment(std::size_t size) = 0;
         virtual void freeSegment(std::size_t id) = 0;
+
+        /* Changes the size of a segment, its id stays the same
+         *
+         * @id segment to resize
+         * @newSize new size in bytes
+         *
+         * @return the resized segment, the first min(old size, <newSize>) bytes are preserved
+         *
+         * Segments get resized in place if there is room behind them, otherwise their content gets moved and pointers
+         * into them are invalid afterwards. Pins are kept, see <unpinSegment>.
+         */
+        virtual Segment resizeSegment(std::size_t id, std::size_t newSize) = 0;
+
+        /* Releases a pin taken by <createSegment> or <getSegment>
+         *
+         * @id id of the pinned segment
+         * @dirty <true> if the segment was modified while it was pinned
+         *
+         * Pointers into the segment may get invalid once all of its pins got released.
+         */
+        virtual void unpinSegment(std::size_t id, bool dirty) {
+            (void)id;
+            (void)dirty;
+        }
+
+        /* Exempts a segment from pin counting, it stays in memory until it gets freed
+         *
+         * @id id of a segment the caller holds a pin of
+         *
+         * The pin of the caller gets absorbed, later pins of the segment are not counted and need not be released.
+         * Data structures that keep raw pointers into their segments across calls, e.g. <Index>, use this instead of
+         * unpinning.
+         */
+        virtual void keepResident(std::size_t id) {
+            (void)id;
+        }
+
+        /* Returns <true> if all methods may be called concurrently, see <SynchronizedProvider>
+         */
+        virtual bool isThreadSafe() const {
+            return false;
+        }
 };
 
 typedef std::shared_ptr<AbstractProvider> provider_t;
 
+/* Pin of a single segment that gets released on destruction
+ *
+ * Copies pin the segment again. Empty pins have the id 0.
+ */
+class SegmentPin {
+    public:
+        SegmentPin() : provider(nullptr), segment(0, nullptr, 0), dirty(false) {}
+
+        /* Pins the segment <id> of <provider_>
+         */
+        SegmentPin(AbstractProvider* provider_, std::size_t id) : provider(provider_), segment(provider_->getSegment(id)), dirty(false) {}
+
+        SegmentPin(const SegmentPin& other) : SegmentPin() {
+            if (other.provider != nullptr) {
+                provider = other.provider;
+                segment = provider->getSegment(other.segment.id());
+            }
+        }
+
+        SegmentPin(SegmentPin&& other) noexcept : provider(other.provider), segment(other.segment), dirty(other.dirty) {
+            other.provider = nullptr;
+        }
+
+        ~SegmentPin() {
+            release();
+        }
+
+        SegmentPin& operator=(SegmentPin other) {
+            std::swap(provider, other.provider);
+            std::swap(segment, other.segment);
+            std::swap(dirty, other.dirty);
+            return *this;
+        }
+
+        std::size_t id() const {
+            return (provider != nullptr) ? segment.id() : 0;
+        }
+
+        void* ptr() const {
+            return segment.ptr();
+        }
+
+        std::size_t size() const {
+            return segment.size();
+        }
+
+        /* Marks the segment as modified, so it gets written back before it is evicted
+         */
+        void markDirty() {
+            dirty = true;
+        }
+
+        /* Unpins the segment early, the pin is empty afterwards
+         */
+        void release() {
+            if (provider != nullptr) {
+                provider->unpinSegment(segment.id(), dirty);
+                provider = nullptr;
+            }
+        }
+
+    private:
+        AbstractProvider* provider;
+        Segment segment;
+        bool dirty;
+};
+
 }
 
 #endif
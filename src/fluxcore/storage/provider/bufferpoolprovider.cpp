@@ -0,0 +1,315 @@
+#include "bufferpoolprovider.hpp"
+#include "heap.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace fluxcore;
+
+constexpr std::size_t BufferPoolProvider::noSpill;
+
+static constexpr std::size_t pageSize = 4096;
+
+static std::size_t spillCapacity(std::size_t size) {
+    return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+static std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + strerror(errno));
+}
+
+BufferPoolProvider::BufferPoolProvider(const std::string& spillPath, std::size_t budget_) :
+        fd(-1),
+        budget(budget_),
+        residentBytes(0),
+        faults(0),
+        hand(0),
+        spillEnd(0),
+        frames(1, Frame()) { // id 0 is reserved as null id
+    fd = open(spillPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        throw systemError("Cannot open spill file " + spillPath);
+    }
+    unlink(spillPath.c_str());
+}
+
+BufferPoolProvider::~BufferPoolProvider() {
+    for (Frame& f : frames) {
+        if (f.used && f.resident) {
+            free(f.ptr);
+        }
+    }
+    close(fd);
+}
+
+Segment BufferPoolProvider::createSegment(std::size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    void* ptr = allocate(size);
+
+    std::size_t id;
+    if (!freeIDs.empty()) {
+        id = freeIDs.back();
+        freeIDs.pop_back();
+    } else {
+        id = frames.size();
+        frames.push_back(Frame());
+    }
+
+    Frame& f = frames[id];
+    f.ptr = ptr;
+    f.size = size;
+    f.pins = 1;
+    f.spillOffset = noSpill;
+    f.used = true;
+    f.resident = true;
+    f.referenced = true;
+    f.dirty = true;
+
+    return Segment(id, ptr, size);
+}
+
+Segment BufferPoolProvider::getSegment(std::size_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Frame& f = frame(id);
+
+    load(f);
+    if (!f.permanent) {
+        ++f.pins;
+    }
+    f.referenced = true;
+    return Segment(id, f.ptr, f.size);
+}
+
+void BufferPoolProvider::freeSegment(std::size_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Frame& f = frame(id);
+
+    if (f.resident) {
+        free(f.ptr);
+        residentBytes -= f.size;
+    }
+    releaseSpill(f);
+
+    f = Frame();
+    freeIDs.push_back(id);
+}
+
+Segment BufferPoolProvider::resizeSegment(std::size_t id, std::size_t newSize) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Frame& f = frame(id);
+    load(f);
+
+    if (newSize > f.size) {
+        // the segment itself must not be picked as victim
+        ++f.pins;
+        makeRoom(newSize - f.size);
+        --f.pins;
+    }
+
+    resizeAligned(f.ptr, f.size, newSize);
+    residentBytes = residentBytes - f.size + newSize;
+    if (spillCapacity(newSize) > spillCapacity(f.size)) {
+        releaseSpill(f);
+    }
+    f.size = newSize;
+    f.referenced = true;
+    f.dirty = true;
+
+    return Segment(id, f.ptr, f.size);
+}
+
+void BufferPoolProvider::unpinSegment(std::size_t id, bool dirty) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Frame& f = frame(id);
+
+    if (f.permanent) {
+        return;
+    }
+    if (f.pins == 0) {
+        throw std::runtime_error("Segment is not pinned!");
+    }
+    --f.pins;
+    f.dirty = f.dirty || dirty;
+}
+
+void BufferPoolProvider::keepResident(std::size_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Frame& f = frame(id);
+
+    if (f.permanent) {
+        return;
+    }
+    if (f.pins == 0) {
+        throw std::runtime_error("Segment is not pinned!");
+    }
+    f.pins = 0;
+    f.permanent = true;
+}
+
+bool BufferPoolProvider::isThreadSafe() const {
+    return true;
+}
+
+std::size_t BufferPoolProvider::getResidentBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return residentBytes;
+}
+
+std::size_t BufferPoolProvider::getFaultCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return faults;
+}
+
+std::size_t BufferPoolProvider::getSpillBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return spillEnd;
+}
+
+BufferPoolProvider::Frame& BufferPoolProvider::frame(std::size_t id) {
+    if ((id == 0) || (id >= frames.size()) || !frames[id].used) {
+        throw std::runtime_error("Unknown segment!");
+    }
+    return frames[id];
+}
+
+void BufferPoolProvider::load(Frame& f) {
+    if (f.resident) {
+        return;
+    }
+
+    void* ptr = allocate(f.size);
+    std::size_t done = 0;
+    while (done < f.size) {
+        ssize_t n = pread(fd, static_cast<char*>(ptr) + done, f.size - done, static_cast<off_t>(f.spillOffset + done));
+        if (n <= 0) {
+            free(ptr);
+            residentBytes -= f.size;
+            throw systemError("Cannot read spill file");
+        }
+        done += static_cast<std::size_t>(n);
+    }
+
+    f.ptr = ptr;
+    f.resident = true;
+    f.dirty = false;
+    ++faults;
+}
+
+void* BufferPoolProvider::allocate(std::size_t size) {
+    makeRoom(size);
+
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, segmentAlignment, size) != 0) {
+        throw std::bad_alloc();
+    }
+    residentBytes += size;
+    return ptr;
+}
+
+void BufferPoolProvider::makeRoom(std::size_t size) {
+    // two rounds, the first one may only clear reference bits
+    for (std::size_t steps = 0; (residentBytes + size > budget) && (steps < 2 * frames.size()); ++steps) {
+        hand = (hand + 1) % frames.size();
+        Frame& f = frames[hand];
+        if (!f.used || !f.resident || f.permanent || (f.pins > 0)) {
+            continue;
+        }
+
+        if (f.referenced) {
+            f.referenced = false;
+        } else {
+            evict(f);
+        }
+    }
+}
+
+void BufferPoolProvider::evict(Frame& f) {
+    if ((f.size > 0) && (f.dirty || (f.spillOffset == noSpill))) {
+        if (f.spillOffset == noSpill) {
+            // best fit among the freed ranges, append otherwise
+            std::size_t capacity = spillCapacity(f.size);
+            auto it = freeSpillBySize.lower_bound(capacity);
+            if (it != freeSpillBySize.end()) {
+                f.spillOffset = it->second;
+                freeSpillByOffset.erase(it->second);
+                if (it->first > capacity) {
+                    freeSpillByOffset.insert(std::make_pair(it->second + capacity, it->first - capacity));
+                    freeSpillBySize.insert(std::make_pair(it->first - capacity, it->second + capacity));
+                }
+                freeSpillBySize.erase(it);
+            } else {
+                f.spillOffset = spillEnd;
+                spillEnd += capacity;
+            }
+        }
+
+        std::size_t done = 0;
+        while (done < f.size) {
+            ssize_t n = pwrite(fd, static_cast<const char*>(f.ptr) + done, f.size - done, static_cast<off_t>(f.spillOffset + done));
+            if (n <= 0) {
+                throw systemError("Cannot write spill file");
+            }
+            done += static_cast<std::size_t>(n);
+        }
+        f.dirty = false;
+    }
+
+    free(f.ptr);
+    f.ptr = nullptr;
+    f.resident = false;
+    residentBytes -= f.size;
+}
+
+void BufferPoolProvider::releaseSpill(Frame& f) {
+    if (f.spillOffset != noSpill) {
+        releaseSpillRange(f.spillOffset, spillCapacity(f.size));
+        f.spillOffset = noSpill;
+    }
+}
+
+void BufferPoolProvider::releaseSpillRange(std::size_t offset, std::size_t capacity) {
+    auto eraseBySize = [&](std::size_t size, std::size_t off) {
+        auto range = freeSpillBySize.equal_range(size);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == off) {
+                freeSpillBySize.erase(it);
+                break;
+            }
+        }
+    };
+
+    // merge with right neighbor
+    auto next = freeSpillByOffset.find(offset + capacity);
+    if (next != freeSpillByOffset.end()) {
+        capacity += next->second;
+        eraseBySize(next->second, next->first);
+        freeSpillByOffset.erase(next);
+    }
+
+    // merge with left neighbor
+    auto prev = freeSpillByOffset.lower_bound(offset);
+    if (prev != freeSpillByOffset.begin()) {
+        --prev;
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            capacity += prev->second;
+            eraseBySize(prev->second, prev->first);
+            freeSpillByOffset.erase(prev);
+        }
+    }
+
+    // a free end of the file gets reused by appends
+    if (offset + capacity == spillEnd) {
+        spillEnd = offset;
+        return;
+    }
+
+    freeSpillByOffset.insert(std::make_pair(offset, capacity));
+    freeSpillBySize.insert(std::make_pair(capacity, offset));
+}
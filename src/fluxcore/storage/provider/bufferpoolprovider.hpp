@@ -0,0 +1,109 @@
+#ifndef FLUXCORE_BUFFERPOOLPROVIDER_HPP
+#define FLUXCORE_BUFFERPOOLPROVIDER_HPP
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "abstractprovider.hpp"
+
+namespace fluxcore {
+
+/* Provider that keeps at most <budget> bytes of segments in memory and spills the rest into a file
+ *
+ * Segments whose pins were all released (see <AbstractProvider::unpinSegment>) can get evicted when memory is needed.
+ * Victims are picked by the CLOCK algorithm: a hand sweeps over all resident segments and evicts the first unpinned
+ * one that was not used since the last sweep. Modified segments get written to the spill file, clean ones that already
+ * have a copy there are dropped. <getSegment> reads evicted segments back.
+ *
+ * Pinned segments are never evicted. If they alone exceed the budget, the provider allocates beyond it instead of
+ * failing. Segments passed to <keepResident>, e.g. index nodes, are neither evicted nor pin counted.
+ *
+ * The spill file gets removed right after it was created, so it does not outlive the provider. All methods may be
+ * called concurrently.
+ */
+class BufferPoolProvider : public AbstractProvider {
+    public:
+        /* Creates a provider
+         *
+         * @spillPath path of the spill file, an existing file gets replaced
+         * @budget memory budget in bytes
+         */
+        BufferPoolProvider(const std::string& spillPath, std::size_t budget_);
+        ~BufferPoolProvider();
+
+        Segment createSegment(std::size_t size) override;
+        Segment getSegment(std::size_t id) override;
+        void freeSegment(std::size_t id) override;
+        Segment resizeSegment(std::size_t id, std::size_t newSize) override;
+        void unpinSegment(std::size_t id, bool dirty) override;
+        void keepResident(std::size_t id) override;
+        bool isThreadSafe() const override;
+
+        /* Returns the number of bytes of segments that are currently in memory
+         */
+        std::size_t getResidentBytes() const;
+
+        /* Returns the number of segments that were read back from the spill file so far
+         */
+        std::size_t getFaultCount() const;
+
+        /* Returns the size of the used part of the spill file in bytes, including freed ranges in between
+         */
+        std::size_t getSpillBytes() const;
+
+    private:
+        struct Frame {
+            void* ptr;
+            std::size_t size;
+            std::size_t pins;
+            std::size_t spillOffset; // <noSpill> if the segment has no copy in the spill file
+            bool used;
+            bool resident;
+            bool referenced;
+            bool dirty;
+            bool permanent; // see <keepResident>, pins are not counted
+        };
+
+        static constexpr std::size_t noSpill = ~std::size_t(0);
+
+        mutable std::mutex mutex;
+        int fd;
+        std::size_t budget;
+        std::size_t residentBytes;
+        std::size_t faults;
+        std::size_t hand;
+        std::size_t spillEnd;
+        std::vector<Frame> frames;
+        std::vector<std::size_t> freeIDs;
+        std::map<std::size_t, std::size_t> freeSpillByOffset; // offset => capacity
+        std::multimap<std::size_t, std::size_t> freeSpillBySize; // capacity => offset
+
+        /* Returns the frame of a live segment, throws for unknown ids
+         */
+        Frame& frame(std::size_t id);
+
+        /* Reads an evicted segment back from the spill file
+         */
+        void load(Frame& f);
+
+        /* Allocates <size> bytes of memory, see <makeRoom>
+         */
+        void* allocate(std::size_t size);
+
+        /* Evicts unpinned segments until <size> more bytes fit into the budget or nothing is left to evict
+         */
+        void makeRoom(std::size_t size);
+
+        void evict(Frame& f);
+        void releaseSpill(Frame& f);
+
+        /* Marks a range of the spill file as free, merges it with free neighbors and gives a free end of the file back
+         */
+        void releaseSpillRange(std::size_t offset, std::size_t capacity);
+};
+
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef FLUXCORE_HEAP_HPP
+#define FLUXCORE_HEAP_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <malloc.h>
+
+#include "abstractprovider.hpp"
+
+namespace fluxcore {
+
+/* Resizes a heap block that was allocated by <posix_memalign> with <AbstractProvider::segmentAlignment>
+ *
+ * @ptr the block, gets updated to its new location
+ * @oldSize number of bytes that are used so far
+ * @newSize new size in bytes
+ *
+ * Blocks stay in place as long as <newSize> fits into their usable size, which covers every shrink. Growth goes
+ * through <realloc>, which extends blocks in place or remaps large ones. Only if the moved block lost its alignment,
+ * the content gets copied once more. Throws <std::bad_alloc> if the memory is exhausted, <ptr> still holds the old
+ * content in this case.
+ */
+inline void resizeAligned(void*& ptr, std::size_t oldSize, std::size_t newSize) {
+    if (newSize <= malloc_usable_size(ptr)) {
+        return;
+    }
+
+    void* moved = realloc(ptr, newSize);
+    if (moved == nullptr) {
+        throw std::bad_alloc();
+    }
+    ptr = moved;
+
+    if (reinterpret_cast<std::uintptr_t>(moved) % AbstractProvider::segmentAlignment != 0) {
+        void* aligned = nullptr;
+        if (posix_memalign(&aligned, AbstractProvider::segmentAlignment, newSize) != 0) {
+            throw std::bad_alloc();
+        }
+        memcpy(aligned, moved, oldSize);
+        free(moved);
+        ptr = aligned;
+    }
+}
+
+}
+
+#endif
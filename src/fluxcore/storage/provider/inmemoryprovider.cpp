@@ -1,33 +1,100 @@
 #include "inmemoryprovider.hpp"
+#include "heap.hpp"
 
 #include <cstdlib>
+#include <limits>
+#include <new>
+#include <stdexcept>
 
 using namespace fluxcore;
 
+constexpr std::size_t InmemoryProvider::chunkSize;
+
+// generations use 31 bits, the highest id bit stays clear for decorators like <SlabProvider>
+static constexpr std::size_t slotBits = 32;
+static constexpr std::uint32_t generationMask = 0x7fffffff;
+
 InmemoryProvider::~InmemoryProvider() {
-    for (auto& it : segments) {
-        free(it.second.ptr());
+    for (std::uint32_t slot = 1; slot < nSlots; ++slot) {
+        Entry& e = chunks[slot / chunkSize][slot % chunkSize];
+        if (e.used) {
+            free(e.ptr);
+        }
     }
 }
 
 Segment InmemoryProvider::createSegment(std::size_t size) {
-    void* ptr = malloc(size);
-    Segment segment{
-        counter++,
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, segmentAlignment, size) != 0) {
+        throw std::bad_alloc();
+    }
+
+    std::uint32_t slot = freeList;
+    if (slot != 0) {
+        freeList = chunks[slot / chunkSize][slot % chunkSize].nextFree;
+    } else {
+        if (nSlots == std::numeric_limits<std::uint32_t>::max()) {
+            free(ptr);
+            throw std::runtime_error("Too many segments!");
+        }
+
+        slot = nSlots;
+        if (slot / chunkSize == chunks.size()) {
+            Entry* chunk = new (std::nothrow) Entry[chunkSize]();
+            if (chunk == nullptr) {
+                free(ptr);
+                throw std::bad_alloc();
+            }
+            chunks.emplace_back(chunk);
+        }
+        ++nSlots;
+    }
+
+    Entry& e = chunks[slot / chunkSize][slot % chunkSize];
+    e.ptr = ptr;
+    e.size = size;
+    e.used = true;
+
+    return Segment(
+        (static_cast<std::size_t>(e.generation) << slotBits) | slot,
         ptr,
         size
-    };
-    segments.insert(std::make_pair(segment.id(), segment));
-    return segment;
+    );
 }
 
 Segment InmemoryProvider::getSegment(std::size_t id) {
-   return segments.at(id);
+    Entry& e = lookup(id);
+    return Segment(id, e.ptr, e.size);
 }
 
 void InmemoryProvider::freeSegment(std::size_t id) {
-    Segment s = segments.at(id);
-    free(s.ptr());
-    segments.erase(id);
+    Entry& e = lookup(id);
+    free(e.ptr);
+
+    e.ptr = nullptr;
+    e.used = false;
+    e.generation = (e.generation + 1) & generationMask;
+    e.nextFree = freeList;
+    freeList = static_cast<std::uint32_t>(id);
+}
+
+Segment InmemoryProvider::resizeSegment(std::size_t id, std::size_t newSize) {
+    Entry& e = lookup(id);
+    resizeAligned(e.ptr, e.size, newSize);
+    e.size = newSize;
+
+    return Segment(id, e.ptr, e.size);
 }
 
+InmemoryProvider::Entry& InmemoryProvider::lookup(std::size_t id) const {
+    std::size_t slot = id & ((std::size_t(1) << slotBits) - 1);
+    if ((slot == 0) || (slot >= nSlots)) {
+        throw std::runtime_error("Unknown segment!");
+    }
+
+    Entry& e = chunks[slot / chunkSize][slot % chunkSize];
+    if (!e.used || (e.generation != (id >> slotBits))) {
+        throw std::runtime_error("Unknown segment!");
+    }
+    return e;
+}
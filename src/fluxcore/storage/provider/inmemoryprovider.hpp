@@ -1,27 +1,53 @@
 #ifndef FLUXCORE_INMEMORYPROVIDER_HPP
 #define FLUXCORE_INMEMORYPROVIDER_HPP
 
-#include <map>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 #include "abstractprovider.hpp"
 
 namespace fluxcore {
 
+/* Provider that keeps segments on the heap
+ *
+ * Segments are registered in a directory of fixed-size chunks that is indexed by the segment id, so <getSegment> costs
+ * two dependent loads. Chunks never move, growing the directory only appends chunk pointers.
+ *
+ * The lower 32 bits of an id select the directory slot, the bits above hold the generation of the slot, which gets
+ * bumped when the segment is freed. Freed slots are reused, but ids of freed segments are rejected until the generation
+ * wraps around after 2^31 reuses of the same slot.
+ */
 class InmemoryProvider : public AbstractProvider {
     public:
+        static constexpr std::size_t chunkSize = 4096;
+
         InmemoryProvider() = default;
         ~InmemoryProvider();
 
         Segment createSegment(std::size_t size) override;
         Segment getSegment(std::size_t id) override;
         void freeSegment(std::size_t id) override;
+        Segment resizeSegment(std::size_t id, std::size_t newSize) override;
 
     private:
-        std::map<std::size_t, Segment> segments;
-        std::size_t counter = 1;
+        struct Entry {
+            void* ptr;
+            std::size_t size;
+            std::uint32_t generation;
+            std::uint32_t nextFree; // next slot of the free list, only valid for free slots
+            bool used;
+        };
+
+        std::vector<std::unique_ptr<Entry[]>> chunks;
+        std::uint32_t nSlots = 1; // slot 0 is never used, so ids are never 0
+        std::uint32_t freeList = 0;
+
+        /* Returns the entry of a live segment, throws for unknown or stale ids
+         */
+        Entry& lookup(std::size_t id) const;
 };
 
 }
 
 #endif
-
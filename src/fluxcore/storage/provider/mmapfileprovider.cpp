@@ -0,0 +1,454 @@
+#include "mmapfileprovider.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace fluxcore;
+
+constexpr std::size_t MmapFileProvider::defaultExtentSize;
+
+static constexpr char magic[8] = {'F', 'L', 'U', 'X', 'M', 'M', 'A', 'P'};
+static constexpr std::uint64_t version = 1;
+static constexpr std::size_t lineSize = 64;
+static constexpr std::size_t pageSize = 4096;
+static constexpr std::size_t initialEntries = 64;
+
+struct MmapFileProvider::Header {
+    char magic[8];
+    std::uint64_t version;
+    std::uint64_t extentSize;
+    std::uint64_t nExtents;
+    std::uint64_t nEntries;
+    std::uint64_t root;
+    std::uint64_t reserved[2];
+};
+
+struct MmapFileProvider::Entry {
+    std::uint64_t extent;
+    std::uint64_t offset;
+    std::uint64_t size;
+    std::uint64_t capacity; // 0 marks an unused id
+};
+
+static std::size_t roundUp(std::size_t x, std::size_t to) {
+    return (x + to - 1) / to * to;
+}
+
+static std::size_t capacityFor(std::size_t size) {
+    if (size >= pageSize) {
+        return roundUp(size, pageSize);
+    } else {
+        return roundUp(std::max(size, lineSize), lineSize);
+    }
+}
+
+static std::size_t alignmentFor(std::size_t capacity) {
+    return capacity >= pageSize ? pageSize : lineSize;
+}
+
+static std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + strerror(errno));
+}
+
+MmapFileProvider::MmapFileProvider(const std::string& path_, std::size_t extentSize_) :
+        path(path_),
+        extentSize(roundUp(extentSize_, pageSize)),
+        dirFd(-1),
+        dirBase(nullptr),
+        dirSize(0),
+        bump(0) {
+    // the destructor does not run if the constructor throws
+    try {
+        openFiles();
+    } catch (...) {
+        closeFiles();
+        throw;
+    }
+}
+
+MmapFileProvider::~MmapFileProvider() {
+    closeFiles();
+}
+
+void MmapFileProvider::openFiles() {
+    dirFd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (dirFd < 0) {
+        throw systemError("Cannot open directory file " + path);
+    }
+
+    struct stat st;
+    if (fstat(dirFd, &st) != 0) {
+        throw systemError("Cannot stat directory file " + path);
+    }
+
+    if (st.st_size == 0) {
+        // fresh directory
+        growDirectory(initialEntries);
+        Header* h = header();
+        memcpy(h->magic, magic, sizeof(magic));
+        h->version = version;
+        h->extentSize = extentSize;
+        h->nExtents = 0;
+        h->nEntries = 1; // id 0 is reserved as null id
+        h->root = 0;
+    } else {
+        if (static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+            throw std::runtime_error("Illegal directory file " + path + "!");
+        }
+
+        void* base = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, dirFd, 0);
+        if (base == MAP_FAILED) {
+            throw systemError("Cannot map directory file " + path);
+        }
+        dirBase = base;
+        dirSize = static_cast<std::size_t>(st.st_size);
+
+        Header* h = header();
+        if ((memcmp(h->magic, magic, sizeof(magic)) != 0) || (h->version != version)) {
+            throw std::runtime_error("Illegal directory file " + path + "!");
+        }
+        extentSize = h->extentSize;
+
+        for (std::size_t i = 0; i < h->nExtents; ++i) {
+            openExtent(i, 0, false);
+        }
+        rebuildFreeLists();
+    }
+}
+
+void MmapFileProvider::closeFiles() {
+    for (auto& e : extents) {
+        munmap(e.base, e.size);
+        close(e.fd);
+    }
+    extents.clear();
+
+    if (dirBase != nullptr) {
+        munmap(dirBase, dirSize);
+        dirBase = nullptr;
+    }
+    if (dirFd >= 0) {
+        close(dirFd);
+        dirFd = -1;
+    }
+}
+
+Segment MmapFileProvider::createSegment(std::size_t size) {
+    std::size_t capacity = capacityFor(size);
+    location_t location = allocateRange(capacity);
+    std::size_t id = allocateID();
+
+    Entry* e = entry(id);
+    e->extent = location.first;
+    e->offset = location.second;
+    e->size = size;
+    e->capacity = capacity;
+
+    return Segment(id, static_cast<char*>(extents[location.first].base) + location.second, size);
+}
+
+Segment MmapFileProvider::getSegment(std::size_t id) {
+    if ((id == 0) || (id >= header()->nEntries) || (entry(id)->capacity == 0)) {
+        throw std::runtime_error("Unknown segment!");
+    }
+
+    Entry* e = entry(id);
+    return Segment(id, static_cast<char*>(extents[e->extent].base) + e->offset, e->size);
+}
+
+void MmapFileProvider::freeSegment(std::size_t id) {
+    if ((id == 0) || (id >= header()->nEntries) || (entry(id)->capacity == 0)) {
+        throw std::runtime_error("Unknown segment!");
+    }
+
+    Entry* e = entry(id);
+    releaseRange(location_t(e->extent, e->offset), e->capacity);
+    memset(e, 0, sizeof(Entry));
+    freeIDs.push_back(id);
+}
+
+Segment MmapFileProvider::resizeSegment(std::size_t id, std::size_t newSize) {
+    if ((id == 0) || (id >= header()->nEntries) || (entry(id)->capacity == 0)) {
+        throw std::runtime_error("Unknown segment!");
+    }
+
+    Entry* e = entry(id);
+    location_t location(e->extent, e->offset);
+    std::size_t capacity = capacityFor(newSize);
+
+    if (capacity <= e->capacity) {
+        // shrink in place, the end of the range becomes free
+        if (capacity < e->capacity) {
+            releaseRange(location_t(location.first, location.second + capacity), e->capacity - capacity);
+            e->capacity = capacity;
+        }
+    } else if (!extendRange(location, e->capacity, capacity)) {
+        location_t target = allocateRange(capacity);
+        e = entry(id);
+        memcpy(static_cast<char*>(extents[target.first].base) + target.second, static_cast<char*>(extents[location.first].base) + location.second, e->size);
+        releaseRange(location, e->capacity);
+
+        e->extent = target.first;
+        e->offset = target.second;
+        e->capacity = capacity;
+    } else {
+        e->capacity = capacity;
+    }
+    e->size = newSize;
+
+    return Segment(id, static_cast<char*>(extents[e->extent].base) + e->offset, newSize);
+}
+
+std::size_t MmapFileProvider::getRootID() const {
+    return header()->root;
+}
+
+void MmapFileProvider::setRootID(std::size_t id) {
+    header()->root = id;
+}
+
+void MmapFileProvider::sync() {
+    for (auto& e : extents) {
+        if (msync(e.base, e.size, MS_SYNC) != 0) {
+            throw systemError("Cannot sync extent");
+        }
+    }
+
+    if (msync(dirBase, dirSize, MS_SYNC) != 0) {
+        throw systemError("Cannot sync directory file " + path);
+    }
+}
+
+MmapFileProvider::Header* MmapFileProvider::header() const {
+    return static_cast<Header*>(dirBase);
+}
+
+MmapFileProvider::Entry* MmapFileProvider::entry(std::size_t id) const {
+    return reinterpret_cast<Entry*>(static_cast<char*>(dirBase) + sizeof(Header)) + id;
+}
+
+void MmapFileProvider::growDirectory(std::size_t nEntries) {
+    std::size_t newSize = roundUp(sizeof(Header) + nEntries * sizeof(Entry), pageSize);
+
+    if (ftruncate(dirFd, static_cast<off_t>(newSize)) != 0) {
+        throw systemError("Cannot grow directory file " + path);
+    }
+
+    void* newBase;
+    if (dirBase == nullptr) {
+        newBase = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, dirFd, 0);
+    } else {
+        newBase = mremap(dirBase, dirSize, newSize, MREMAP_MAYMOVE);
+    }
+    if (newBase == MAP_FAILED) {
+        throw systemError("Cannot map directory file " + path);
+    }
+
+    dirBase = newBase;
+    dirSize = newSize;
+}
+
+void MmapFileProvider::openExtent(std::size_t idx, std::size_t size, bool create) {
+    std::string extentPath = path + "." + std::to_string(idx);
+
+    int fd = open(extentPath.c_str(), O_RDWR | (create ? O_CREAT | O_TRUNC : 0), 0644);
+    if (fd < 0) {
+        throw systemError("Cannot open extent file " + extentPath);
+    }
+
+    if (create) {
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            close(fd);
+            throw systemError("Cannot allocate extent file " + extentPath);
+        }
+    } else {
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw systemError("Cannot stat extent file " + extentPath);
+        }
+        size = static_cast<std::size_t>(st.st_size);
+    }
+
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        throw systemError("Cannot map extent file " + extentPath);
+    }
+
+    extents.push_back(Extent{fd, base, size});
+}
+
+std::size_t MmapFileProvider::allocateID() {
+    if (!freeIDs.empty()) {
+        std::size_t id = freeIDs.back();
+        freeIDs.pop_back();
+        return id;
+    }
+
+    std::size_t id = header()->nEntries;
+    if (sizeof(Header) + (id + 1) * sizeof(Entry) > dirSize) {
+        growDirectory(2 * id);
+    }
+    header()->nEntries = id + 1;
+
+    return id;
+}
+
+MmapFileProvider::location_t MmapFileProvider::allocateRange(std::size_t capacity) {
+    std::size_t alignment = alignmentFor(capacity);
+
+    // Step 1: best fit from free ranges
+    for (auto it = freeBySize.lower_bound(capacity); it != freeBySize.end(); ++it) {
+        location_t location = it->second;
+        std::size_t rangeSize = it->first;
+        std::size_t aligned = roundUp(location.second, alignment);
+        std::size_t padding = aligned - location.second;
+
+        if (padding + capacity <= rangeSize) {
+            freeBySize.erase(it);
+            freeByLocation.erase(location);
+
+            if (padding > 0) {
+                releaseRange(location, padding);
+            }
+            if (padding + capacity < rangeSize) {
+                releaseRange(location_t(location.first, aligned + capacity), rangeSize - padding - capacity);
+            }
+
+            return location_t(location.first, aligned);
+        }
+    }
+
+    // Step 2: bump allocation from the current extent
+    if (!extents.empty()) {
+        std::size_t current = extents.size() - 1;
+        std::size_t aligned = roundUp(bump, alignment);
+
+        if (aligned + capacity <= extents[current].size) {
+            if (aligned > bump) {
+                releaseRange(location_t(current, bump), aligned - bump);
+            }
+            bump = aligned + capacity;
+
+            return location_t(current, aligned);
+        }
+    }
+
+    // Step 3: new extent, oversized segments get a dedicated one
+    if (!extents.empty() && (bump < extents.back().size)) {
+        releaseRange(location_t(extents.size() - 1, bump), extents.back().size - bump);
+    }
+
+    std::size_t idx = extents.size();
+    std::size_t size = std::max(extentSize, capacity);
+    openExtent(idx, size, true);
+    header()->nExtents = idx + 1;
+    bump = capacity;
+
+    return location_t(idx, 0);
+}
+
+bool MmapFileProvider::extendRange(location_t location, std::size_t capacity, std::size_t newCapacity) {
+    std::size_t end = location.second + capacity;
+    std::size_t missing = newCapacity - capacity;
+
+    // Step 1: free range right behind the segment
+    auto next = freeByLocation.find(location_t(location.first, end));
+    if ((next != freeByLocation.end()) && (next->second >= missing)) {
+        std::size_t rangeSize = next->second;
+        auto range = freeBySize.equal_range(rangeSize);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == next->first) {
+                freeBySize.erase(it);
+                break;
+            }
+        }
+        freeByLocation.erase(next);
+
+        if (rangeSize > missing) {
+            releaseRange(location_t(location.first, end + missing), rangeSize - missing);
+        }
+        return true;
+    }
+
+    // Step 2: the segment ends at the bump pointer of the current extent
+    if ((location.first + 1 == extents.size()) && (end == bump) && (bump + missing <= extents[location.first].size)) {
+        bump += missing;
+        return true;
+    }
+
+    return false;
+}
+
+void MmapFileProvider::releaseRange(location_t location, std::size_t capacity) {
+    auto eraseBySize = [&](std::size_t size, location_t loc) {
+        auto range = freeBySize.equal_range(size);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == loc) {
+                freeBySize.erase(it);
+                break;
+            }
+        }
+    };
+
+    // merge with right neighbor
+    auto next = freeByLocation.find(location_t(location.first, location.second + capacity));
+    if (next != freeByLocation.end()) {
+        capacity += next->second;
+        eraseBySize(next->second, next->first);
+        freeByLocation.erase(next);
+    }
+
+    // merge with left neighbor
+    auto prev = freeByLocation.lower_bound(location);
+    if (prev != freeByLocation.begin()) {
+        --prev;
+        if ((prev->first.first == location.first) && (prev->first.second + prev->second == location.second)) {
+            location = prev->first;
+            capacity += prev->second;
+            eraseBySize(prev->second, prev->first);
+            freeByLocation.erase(prev);
+        }
+    }
+
+    freeByLocation.insert(std::make_pair(location, capacity));
+    freeBySize.insert(std::make_pair(capacity, location));
+}
+
+void MmapFileProvider::rebuildFreeLists() {
+    Header* h = header();
+    std::vector<std::map<std::size_t, std::size_t>> used(extents.size());
+
+    for (std::size_t id = 1; id < h->nEntries; ++id) {
+        Entry* e = entry(id);
+        if (e->capacity == 0) {
+            freeIDs.push_back(id);
+        } else {
+            used[e->extent].insert(std::make_pair(e->offset, e->capacity));
+        }
+    }
+
+    for (std::size_t i = 0; i < extents.size(); ++i) {
+        std::size_t pos = 0;
+        for (const auto& range : used[i]) {
+            if (range.first > pos) {
+                releaseRange(location_t(i, pos), range.first - pos);
+            }
+            pos = range.first + range.second;
+        }
+
+        if (i + 1 == extents.size()) {
+            bump = pos;
+        } else if (pos < extents[i].size) {
+            releaseRange(location_t(i, pos), extents[i].size - pos);
+        }
+    }
+}
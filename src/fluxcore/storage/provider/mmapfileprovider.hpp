@@ -0,0 +1,108 @@
+#ifndef FLUXCORE_MMAPFILEPROVIDER_HPP
+#define FLUXCORE_MMAPFILEPROVIDER_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "abstractprovider.hpp"
+
+namespace fluxcore {
+
+/* Provider that stores segments in memory mapped files
+ *
+ * The provider uses a directory file (<path>) and a set of extent files (<path>.0, <path>.1, ...). The directory maps
+ * segment ids to (extent, offset, size) triples and is mapped itself, so opening an existing database does not read or
+ * deserialize any segment data. Pages are faulted in when they are touched.
+ *
+ * Extents are never remapped or moved, so pointers returned by <Segment::ptr> stay valid until the segment gets freed or
+ * the provider gets destroyed.
+ */
+class MmapFileProvider : public AbstractProvider {
+    public:
+        static constexpr std::size_t defaultExtentSize = 256 * 1024 * 1024;
+
+        /* Opens or creates a file backed provider
+         *
+         * @path path of the directory file, extent files are stored next to it
+         * @extentSize size of newly created extents, ignored when an existing directory gets opened
+         */
+        explicit MmapFileProvider(const std::string& path, std::size_t extentSize = defaultExtentSize);
+        ~MmapFileProvider();
+
+        Segment createSegment(std::size_t size) override;
+        Segment getSegment(std::size_t id) override;
+        void freeSegment(std::size_t id) override;
+        Segment resizeSegment(std::size_t id, std::size_t newSize) override;
+
+        /* Returns the root id stored in the directory
+         *
+         * The root id can be used to store the id of an anchor segment (e.g. of a <Database>), so the database can be
+         * found when the provider gets reopened. It is 0 for new providers.
+         */
+        std::size_t getRootID() const;
+
+        /* Stores the root id in the directory
+         *
+         * @id id that should be returned by <getRootID> in the future
+         */
+        void setRootID(std::size_t id);
+
+        /* Writes all dirty pages back to the files
+         *
+         * This method blocks until the data reached the files. Unmapping the files (i.e. destroying the provider)
+         * writes the data back as well but does not wait for it.
+         */
+        void sync();
+
+    private:
+        struct Header;
+        struct Entry;
+
+        struct Extent {
+            int fd;
+            void* base;
+            std::size_t size;
+        };
+
+        typedef std::pair<std::size_t, std::size_t> location_t; // (extent, offset)
+
+        std::string path;
+        std::size_t extentSize;
+        int dirFd;
+        void* dirBase;
+        std::size_t dirSize;
+        std::vector<Extent> extents;
+        std::size_t bump;
+        std::vector<std::size_t> freeIDs;
+        std::map<location_t, std::size_t> freeByLocation;
+        std::multimap<std::size_t, location_t> freeBySize;
+
+        Header* header() const;
+        Entry* entry(std::size_t id) const;
+
+        /* Opens or creates the directory and maps all extents, see the constructor
+         */
+        void openFiles();
+
+        /* Unmaps and closes everything that was opened so far
+         */
+        void closeFiles();
+
+        void growDirectory(std::size_t nEntries);
+        void openExtent(std::size_t idx, std::size_t size, bool create);
+        std::size_t allocateID();
+        location_t allocateRange(std::size_t capacity);
+        void releaseRange(location_t location, std::size_t capacity);
+
+        /* Grows the range at <location> in place, returns <false> if the memory behind it is in use
+         */
+        bool extendRange(location_t location, std::size_t capacity, std::size_t newCapacity);
+        void rebuildFreeLists();
+};
+
+}
+
+#endif
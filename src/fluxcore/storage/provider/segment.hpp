@@ -14,15 +14,15 @@ class Segment {
         Segment& operator=(const Segment&) = default;
         Segment& operator=(Segment&&) = default;
 
-        std::size_t id() {
+        std::size_t id() const {
             return myId;
         }
 
-        void* ptr() {
+        void* ptr() const {
             return myPtr;
         }
 
-        std::size_t size() {
+        std::size_t size() const {
             return mySize;
         }
 
@@ -0,0 +1,159 @@
+#include "shardedprovider.hpp"
+#include "heap.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+using namespace fluxcore;
+
+constexpr std::size_t ShardedProvider::chunkSize;
+constexpr std::size_t ShardedProvider::maxShards;
+
+// id layout: generation (31 bits) | slot within the shard (24 bits) | shard (8 bits)
+static constexpr std::size_t shardBits = 8;
+static constexpr std::size_t slotBits = 24;
+static constexpr std::size_t generationShift = shardBits + slotBits;
+static constexpr std::uint32_t generationMask = 0x7fffffff;
+static constexpr std::size_t maxSlots = std::size_t(1) << slotBits;
+static constexpr std::size_t maxChunks = maxSlots / ShardedProvider::chunkSize;
+
+static_assert(ShardedProvider::maxShards == (std::size_t(1) << shardBits), "Shard numbers do not fit into the id!");
+
+// threads get numbered on first use, the number picks their home shard
+static std::atomic<std::size_t> threadCounter(0);
+static thread_local std::size_t threadNumber = threadCounter++;
+
+ShardedProvider::ShardedProvider(std::size_t nShards) {
+    if (nShards == 0) {
+        nShards = std::max(1u, std::thread::hardware_concurrency());
+    }
+    nShards = std::min(nShards, maxShards);
+
+    for (std::size_t i = 0; i < nShards; ++i) {
+        std::unique_ptr<Shard> shard(new Shard());
+        shard->chunks.reset(new std::atomic<Entry*>[maxChunks]);
+        for (std::size_t c = 0; c < maxChunks; ++c) {
+            shard->chunks[c].store(nullptr, std::memory_order_relaxed);
+        }
+        shard->nSlots = 1; // slot 0 is never used, so ids are never 0
+        shard->freeList = 0;
+        shards.push_back(std::move(shard));
+    }
+}
+
+ShardedProvider::~ShardedProvider() {
+    for (auto& shard : shards) {
+        for (std::size_t slot = 1; slot < shard->nSlots; ++slot) {
+            Entry& e = shard->chunks[slot / chunkSize].load(std::memory_order_relaxed)[slot % chunkSize];
+            if (e.used) {
+                free(e.ptr);
+            }
+        }
+        for (std::size_t c = 0; c < maxChunks; ++c) {
+            delete[] shard->chunks[c].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+Segment ShardedProvider::createSegment(std::size_t size) {
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, segmentAlignment, size) != 0) {
+        throw std::bad_alloc();
+    }
+
+    std::size_t shardIdx = threadNumber % shards.size();
+    Shard& shard = *shards[shardIdx];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    std::uint32_t slot = shard.freeList;
+    if (slot != 0) {
+        shard.freeList = shard.chunks[slot / chunkSize].load(std::memory_order_relaxed)[slot % chunkSize].nextFree;
+    } else {
+        if (shard.nSlots == maxSlots) {
+            free(ptr);
+            throw std::runtime_error("Too many segments!");
+        }
+
+        slot = shard.nSlots;
+        if (shard.chunks[slot / chunkSize].load(std::memory_order_relaxed) == nullptr) {
+            Entry* chunk = new (std::nothrow) Entry[chunkSize]();
+            if (chunk == nullptr) {
+                free(ptr);
+                throw std::bad_alloc();
+            }
+            // readers load the pointer without the mutex, so it has to be released after the entries got initialized
+            shard.chunks[slot / chunkSize].store(chunk, std::memory_order_release);
+        }
+        ++shard.nSlots;
+    }
+
+    Entry& e = shard.chunks[slot / chunkSize].load(std::memory_order_relaxed)[slot % chunkSize];
+    e.ptr = ptr;
+    e.size = size;
+    e.used = true;
+
+    return Segment(
+        (static_cast<std::size_t>(e.generation) << generationShift) | (static_cast<std::size_t>(slot) << shardBits) | shardIdx,
+        ptr,
+        size
+    );
+}
+
+Segment ShardedProvider::getSegment(std::size_t id) {
+    Entry& e = lookup(id);
+    return Segment(id, e.ptr, e.size);
+}
+
+void ShardedProvider::freeSegment(std::size_t id) {
+    // the entry belongs to the caller, only the free list needs the lock
+    Entry& e = lookup(id);
+    Shard& shard = *shards[id & (maxShards - 1)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    free(e.ptr);
+
+    e.ptr = nullptr;
+    e.used = false;
+    e.generation = (e.generation + 1) & generationMask;
+    e.nextFree = shard.freeList;
+    shard.freeList = static_cast<std::uint32_t>((id >> shardBits) & (maxSlots - 1));
+}
+
+Segment ShardedProvider::resizeSegment(std::size_t id, std::size_t newSize) {
+    // the entry belongs to the caller and lookups of other segments never touch it, so no lock is needed
+    Entry& e = lookup(id);
+    resizeAligned(e.ptr, e.size, newSize);
+    e.size = newSize;
+
+    return Segment(id, e.ptr, e.size);
+}
+
+bool ShardedProvider::isThreadSafe() const {
+    return true;
+}
+
+std::size_t ShardedProvider::getShardCount() const {
+    return shards.size();
+}
+
+ShardedProvider::Entry& ShardedProvider::lookup(std::size_t id) const {
+    std::size_t shardIdx = id & (maxShards - 1);
+    std::size_t slot = (id >> shardBits) & (maxSlots - 1);
+    if ((shardIdx >= shards.size()) || (slot == 0)) {
+        throw std::runtime_error("Unknown segment!");
+    }
+
+    Entry* chunk = shards[shardIdx]->chunks[slot / chunkSize].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+        throw std::runtime_error("Unknown segment!");
+    }
+
+    Entry& e = chunk[slot % chunkSize];
+    if (!e.used || (e.generation != (id >> generationShift))) {
+        throw std::runtime_error("Unknown segment!");
+    }
+    return e;
+}
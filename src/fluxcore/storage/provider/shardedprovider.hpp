@@ -0,0 +1,69 @@
+#ifndef FLUXCORE_SHARDEDPROVIDER_HPP
+#define FLUXCORE_SHARDEDPROVIDER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "abstractprovider.hpp"
+
+namespace fluxcore {
+
+/* Thread-safe provider that keeps segments on the heap
+ *
+ * The segment directory is split into shards, each with its own mutex, free list and chunked directory like the one of
+ * <InmemoryProvider>. Every thread allocates from its home shard, so threads only contend when they free segments of
+ * other threads or when there are more threads than shards. <getSegment> takes no lock at all: chunks of a shard are
+ * published through atomic pointers and never move.
+ *
+ * The lower 32 bits of an id hold the slot within the shard and the shard, the bits above hold the generation of the
+ * slot, so ids of freed segments are rejected. Ids must not be used concurrently with freeing the same segment.
+ */
+class ShardedProvider : public AbstractProvider {
+    public:
+        static constexpr std::size_t chunkSize = 4096;
+        static constexpr std::size_t maxShards = 256;
+
+        /* Creates a provider with <nShards> shards, 0 means one per hardware thread
+         */
+        explicit ShardedProvider(std::size_t nShards = 0);
+        ~ShardedProvider();
+
+        Segment createSegment(std::size_t size) override;
+        Segment getSegment(std::size_t id) override;
+        void freeSegment(std::size_t id) override;
+        Segment resizeSegment(std::size_t id, std::size_t newSize) override;
+        bool isThreadSafe() const override;
+
+        /* Returns the number of shards
+         */
+        std::size_t getShardCount() const;
+
+    private:
+        struct Entry {
+            void* ptr;
+            std::size_t size;
+            std::uint32_t generation;
+            std::uint32_t nextFree; // next slot of the free list, only valid for free slots
+            bool used;
+        };
+
+        struct Shard {
+            std::mutex mutex;
+            std::unique_ptr<std::atomic<Entry*>[]> chunks;
+            std::uint32_t nSlots;
+            std::uint32_t freeList;
+        };
+
+        std::vector<std::unique_ptr<Shard>> shards;
+
+        /* Returns the entry of a live segment, throws for unknown or stale ids
+         */
+        Entry& lookup(std::size_t id) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,196 @@
+#include "slabprovider.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace fluxcore;
+
+constexpr std::size_t SlabProvider::slabSize;
+constexpr std::size_t SlabProvider::maxSlotSize;
+
+// id layout: tag (1 bit) | size class (7 bits) | slab (44 bits) | slot (12 bits)
+static constexpr std::size_t slotBits = 12;
+static constexpr std::size_t slabBits = 44;
+static constexpr std::size_t classShift = slotBits + slabBits;
+static constexpr std::size_t slabTag = std::size_t(1) << 63;
+static constexpr std::size_t minSlotShift = 6;
+
+// marks slots whose segment outgrew the size class, the slot stores the id of the segment of the inner provider
+static constexpr std::uint32_t movedSlot = 0xffffffff;
+
+static_assert((std::size_t(1) << minSlotShift) == AbstractProvider::segmentAlignment, "Slots have to keep the segment alignment!");
+static_assert((SlabProvider::slabSize >> minSlotShift) <= (std::size_t(1) << slotBits), "Slot numbers do not fit into the id!");
+
+static std::size_t classOf(std::size_t size) {
+    std::size_t cls = 0;
+    while ((std::size_t(1) << (cls + minSlotShift)) < size) {
+        ++cls;
+    }
+    return cls;
+}
+
+static std::size_t slotSize(std::size_t cls) {
+    return std::size_t(1) << (cls + minSlotShift);
+}
+
+SlabProvider::SlabProvider(const provider_t& inner_) : inner(inner_), classes(classOf(maxSlotSize) + 1) {
+    for (auto& c : classes) {
+        c.freeList = 0;
+        c.nextSlot = 0;
+    }
+}
+
+SlabProvider::~SlabProvider() {
+    for (auto& c : classes) {
+        for (auto& s : c.slabs) {
+            inner->freeSegment(s.segmentId);
+        }
+    }
+}
+
+Segment SlabProvider::createSegment(std::size_t size) {
+    if ((size == 0) || (size > maxSlotSize)) {
+        return inner->createSegment(size);
+    }
+
+    std::size_t cls = classOf(size);
+    SizeClass& c = classes[cls];
+    std::size_t slotsPerSlab = slabSize / slotSize(cls);
+
+    std::size_t id;
+    if (c.freeList != 0) {
+        // the free slot stores the id of the next one
+        id = c.freeList;
+        c.freeList = *static_cast<std::size_t*>(getSegment(id).ptr());
+    } else {
+        if (c.slabs.empty() || (c.nextSlot == slotsPerSlab)) {
+            if (c.slabs.size() == (std::size_t(1) << slabBits)) {
+                throw std::runtime_error("Too many slabs!");
+            }
+
+            Segment s = inner->createSegment(slabSize);
+            c.slabs.push_back(Slab{s.id(), static_cast<char*>(s.ptr()), std::vector<std::uint32_t>(slotsPerSlab, 0)});
+            c.nextSlot = 0;
+        }
+
+        id = slabTag | (cls << classShift) | ((c.slabs.size() - 1) << slotBits) | c.nextSlot;
+        ++c.nextSlot;
+    }
+
+    std::size_t slot;
+    Slab& slab = locate(id, slot);
+    slab.sizes[slot] = static_cast<std::uint32_t>(size);
+
+    return Segment(id, slab.base + slot * slotSize(cls), size);
+}
+
+Segment SlabProvider::getSegment(std::size_t id) {
+    if ((id & slabTag) == 0) {
+        return inner->getSegment(id);
+    }
+
+    std::size_t slot;
+    Slab& slab = locate(id, slot);
+    std::size_t cls = (id & ~slabTag) >> classShift;
+    char* ptr = slab.base + slot * slotSize(cls);
+
+    if (slab.sizes[slot] == movedSlot) {
+        Segment moved = inner->getSegment(*reinterpret_cast<std::size_t*>(ptr));
+        return Segment(id, moved.ptr(), moved.size());
+    }
+    return Segment(id, ptr, slab.sizes[slot]);
+}
+
+void SlabProvider::freeSegment(std::size_t id) {
+    if ((id & slabTag) == 0) {
+        inner->freeSegment(id);
+        return;
+    }
+
+    std::size_t slot;
+    Slab& slab = locate(id, slot);
+    if (slab.sizes[slot] == 0) {
+        throw std::runtime_error("Unknown segment!");
+    }
+
+    std::size_t cls = (id & ~slabTag) >> classShift;
+    char* ptr = slab.base + slot * slotSize(cls);
+    if (slab.sizes[slot] == movedSlot) {
+        inner->freeSegment(*reinterpret_cast<std::size_t*>(ptr));
+    }
+
+    SizeClass& c = classes[cls];
+    *reinterpret_cast<std::size_t*>(ptr) = c.freeList;
+    c.freeList = id;
+    slab.sizes[slot] = 0;
+}
+
+Segment SlabProvider::resizeSegment(std::size_t id, std::size_t newSize) {
+    if ((id & slabTag) == 0) {
+        return inner->resizeSegment(id, newSize);
+    }
+
+    std::size_t slot;
+    Slab& slab = locate(id, slot);
+    std::size_t cls = (id & ~slabTag) >> classShift;
+    char* ptr = slab.base + slot * slotSize(cls);
+    std::uint32_t size = slab.sizes[slot];
+
+    if (size == 0) {
+        throw std::runtime_error("Unknown segment!");
+    } else if (size == movedSlot) {
+        Segment moved = inner->resizeSegment(*reinterpret_cast<std::size_t*>(ptr), newSize);
+        return Segment(id, moved.ptr(), moved.size());
+    } else if ((newSize > 0) && (newSize <= slotSize(cls))) {
+        slab.sizes[slot] = static_cast<std::uint32_t>(newSize);
+        return Segment(id, ptr, newSize);
+    }
+
+    // the size class is part of the id, so the slot turns into a forward to a segment of the inner provider
+    Segment moved = inner->createSegment(newSize);
+    memcpy(moved.ptr(), ptr, std::min<std::size_t>(size, newSize));
+    *reinterpret_cast<std::size_t*>(ptr) = moved.id();
+    slab.sizes[slot] = movedSlot;
+
+    return Segment(id, moved.ptr(), newSize);
+}
+
+void SlabProvider::unpinSegment(std::size_t id, bool dirty) {
+    // slabs stay pinned as long as they exist, so only segments of the inner provider have pins
+    if ((id & slabTag) == 0) {
+        inner->unpinSegment(id, dirty);
+        return;
+    }
+
+    std::size_t slot;
+    Slab& slab = locate(id, slot);
+    if (slab.sizes[slot] == movedSlot) {
+        inner->unpinSegment(*reinterpret_cast<std::size_t*>(slab.base + slot * slotSize((id & ~slabTag) >> classShift)), dirty);
+    }
+}
+
+void SlabProvider::keepResident(std::size_t id) {
+    if ((id & slabTag) == 0) {
+        inner->keepResident(id);
+        return;
+    }
+
+    std::size_t slot;
+    Slab& slab = locate(id, slot);
+    if (slab.sizes[slot] == movedSlot) {
+        inner->keepResident(*reinterpret_cast<std::size_t*>(slab.base + slot * slotSize((id & ~slabTag) >> classShift)));
+    }
+}
+
+SlabProvider::Slab& SlabProvider::locate(std::size_t id, std::size_t& slot) {
+    std::size_t cls = (id & ~slabTag) >> classShift;
+    std::size_t slabIdx = (id >> slotBits) & ((std::size_t(1) << slabBits) - 1);
+    slot = id & ((std::size_t(1) << slotBits) - 1);
+
+    if ((cls >= classes.size()) || (slabIdx >= classes[cls].slabs.size()) || (slot >= slabSize / slotSize(cls))) {
+        throw std::runtime_error("Unknown segment!");
+    }
+
+    return classes[cls].slabs[slabIdx];
+}
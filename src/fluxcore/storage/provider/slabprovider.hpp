@@ -0,0 +1,65 @@
+#ifndef FLUXCORE_SLABPROVIDER_HPP
+#define FLUXCORE_SLABPROVIDER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "abstractprovider.hpp"
+
+namespace fluxcore {
+
+/* Provider that packs small segments into slabs of another provider
+ *
+ * Segments of up to <maxSlotSize> bytes get rounded up to a power of two (the size class, at least
+ * <segmentAlignment>) and are carved out of slabs of <slabSize> bytes that are allocated from the inner provider.
+ * Allocating a slot is a pointer bump in the current slab of the class, freed slots go into a free list of their
+ * class, which is threaded through the freed slots themselves. Larger segments are passed to the inner provider.
+ *
+ * Size class, slab and slot are encoded in the segment id, so <getSegment> is a plain address computation. Ids of
+ * slots have the highest bit set, which separates them from the ids of the inner provider.
+ *
+ * Slots that outgrow their size class through <resizeSegment> forward to a segment of the inner provider, so their id
+ * stays valid.
+ *
+ * The slab directory is kept in memory, so slots do not survive reopening a persistent inner provider. Slabs are
+ * never returned to the inner provider. Wrap it into a <SynchronizedProvider> for concurrent use.
+ */
+class SlabProvider : public AbstractProvider {
+    public:
+        static constexpr std::size_t slabSize = 256 * 1024;
+        static constexpr std::size_t maxSlotSize = 8 * 1024;
+
+        explicit SlabProvider(const provider_t& inner_);
+        ~SlabProvider();
+
+        Segment createSegment(std::size_t size) override;
+        Segment getSegment(std::size_t id) override;
+        void freeSegment(std::size_t id) override;
+        Segment resizeSegment(std::size_t id, std::size_t newSize) override;
+        void unpinSegment(std::size_t id, bool dirty) override;
+        void keepResident(std::size_t id) override;
+
+    private:
+        struct Slab {
+            std::size_t segmentId;
+            char* base;
+            std::vector<std::uint32_t> sizes; // requested size per slot, 0 marks free slots
+        };
+
+        struct SizeClass {
+            std::vector<Slab> slabs;
+            std::size_t freeList;   // id of the first free slot, 0 if there is none
+            std::size_t nextSlot;   // bump pointer into the last slab
+        };
+
+        provider_t inner;
+        std::vector<SizeClass> classes;
+
+        /* Returns the slab and slot of an id, throws for unknown ids
+         */
+        Slab& locate(std::size_t id, std::size_t& slot);
+};
+
+}
+
+#endif
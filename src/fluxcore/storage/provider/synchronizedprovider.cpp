@@ -0,0 +1,39 @@
+#include "synchronizedprovider.hpp"
+
+using namespace fluxcore;
+
+SynchronizedProvider::SynchronizedProvider(const provider_t& inner_) : inner(inner_) {}
+
+Segment SynchronizedProvider::createSegment(std::size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return inner->createSegment(size);
+}
+
+Segment SynchronizedProvider::getSegment(std::size_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return inner->getSegment(id);
+}
+
+void SynchronizedProvider::freeSegment(std::size_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    inner->freeSegment(id);
+}
+
+Segment SynchronizedProvider::resizeSegment(std::size_t id, std::size_t newSize) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return inner->resizeSegment(id, newSize);
+}
+
+void SynchronizedProvider::unpinSegment(std::size_t id, bool dirty) {
+    std::lock_guard<std::mutex> lock(mutex);
+    inner->unpinSegment(id, dirty);
+}
+
+void SynchronizedProvider::keepResident(std::size_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    inner->keepResident(id);
+}
+
+bool SynchronizedProvider::isThreadSafe() const {
+    return true;
+}
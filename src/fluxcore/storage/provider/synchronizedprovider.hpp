@@ -0,0 +1,34 @@
+#ifndef FLUXCORE_SYNCHRONIZEDPROVIDER_HPP
+#define FLUXCORE_SYNCHRONIZEDPROVIDER_HPP
+
+#include <mutex>
+
+#include "abstractprovider.hpp"
+
+namespace fluxcore {
+
+/* Decorator that makes any provider thread-safe
+ *
+ * All calls get serialized by a single mutex. Segment memory itself is not protected, concurrent users have to work on
+ * different segments.
+ */
+class SynchronizedProvider : public AbstractProvider {
+    public:
+        explicit SynchronizedProvider(const provider_t& inner_);
+
+        Segment createSegment(std::size_t size) override;
+        Segment getSegment(std::size_t id) override;
+        void freeSegment(std::size_t id) override;
+        Segment resizeSegment(std::size_t id, std::size_t newSize) override;
+        void unpinSegment(std::size_t id, bool dirty) override;
+        void keepResident(std::size_t id) override;
+        bool isThreadSafe() const override;
+
+    private:
+        provider_t inner;
+        std::mutex mutex;
+};
+
+}
+
+#endif
@@ -1,82 +1,236 @@
 #include "table.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 #include "../datatypes/combinedtype.hpp"
+#include "transpose.hpp"
 
 using namespace fluxcore;
 
-Table::Table(const std::list<typeptr_t>& columns_, const provider_t& provider_) : columns(columns_.size()) {
+constexpr std::size_t Table::parallelIngestBytes;
+
+Table::Cursor::Cursor(std::vector<Column::Cursor>&& cursors_, std::vector<std::size_t>&& elementSizes_, std::size_t lastRow_, std::size_t batchRows_) :
+        cursors(std::move(cursors_)),
+        spans(cursors.size(), Column::Span{0, 0, nullptr}),
+        elementSizes(std::move(elementSizes_)),
+        buffers(cursors.size()),
+        nextRow(0),
+        lastRow(lastRow_),
+        batchRows(batchRows_) {}
+
+std::size_t Table::Cursor::available(std::size_t i) {
+    Column::Span& span = spans[i];
+    if ((span.rowCount == 0) && !cursors[i].next(span)) {
+        throw std::runtime_error("Column ended unexpectedly!");
+    }
+    return span.rowCount;
+}
+
+void Table::Cursor::consume(std::size_t i, std::size_t n) {
+    Column::Span& span = spans[i];
+    span.firstRow += n;
+    span.rowCount -= n;
+    span.data = static_cast<const char*>(span.data) + n * elementSizes[i];
+}
+
+bool Table::Cursor::next(Batch& batch) {
+    if (nextRow >= lastRow) {
+        return false;
+    }
+
+    std::size_t n = std::min(batchRows, lastRow - nextRow);
+    batch.firstRow = nextRow;
+    batch.rowCount = n;
+    batch.data.resize(cursors.size());
+
+    for (std::size_t i = 0; i < cursors.size(); ++i) {
+        if (available(i) >= n) {
+            batch.data[i] = spans[i].data;
+            consume(i, n);
+            continue;
+        }
+
+        // the batch crosses the end of the span, copy it together
+        buffers[i].resize(batchRows * elementSizes[i]);
+        char* target = buffers[i].data();
+        for (std::size_t copied = 0; copied < n;) {
+            std::size_t m = std::min(available(i), n - copied);
+            memcpy(target + copied * elementSizes[i], spans[i].data, m * elementSizes[i]);
+            consume(i, m);
+            copied += m;
+        }
+        batch.data[i] = target;
+    }
+
+    nextRow += n;
+    return true;
+}
+
+Table::Table(const std::list<typeptr_t>& columns_, const provider_t& provider_) : provider(provider_), columns(columns_.size()) {
     std::size_t i = 0;
     for (const auto& t : columns_) {
         columns[i++] = std::make_shared<Column>(t, provider_);
     }
+    init();
 }
 
-Table::Table(const std::list<std::pair<typeptr_t, std::size_t>>& columns_, const provider_t& provider_) : columns(columns_.size()) {
+Table::Table(const std::list<std::pair<typeptr_t, std::size_t>>& columns_, const provider_t& provider_) : provider(provider_), columns(columns_.size()) {
     std::size_t i = 0;
     for (const auto& p : columns_) {
         columns[i++] = std::make_shared<Column>(p.first, provider_, p.second);
     }
+    init();
+}
+
+void Table::init() {
+    std::vector<typeptr_t> types;
+    for (const auto& c : columns) {
+        types.push_back(c->getType());
+    }
+    rowType = std::make_shared<Tuple>(types);
+
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+        offsets.push_back(rowType->getOffset(i));
+        sizes.push_back(types[i]->getSize());
+    }
 }
 
 column_t Table::getColumn(std::size_t i) const {
     return columns.at(i);
 }
 
-void Table::addColumnRanges(std::list<std::pair<dataptrconst_t, dataptrconst_t>> ranges) {
+std::size_t Table::getColumnCount() const {
+    return columns.size();
+}
+
+typeptr_t Table::getRowType() const {
+    return rowType;
+}
+
+void Table::addColumnRanges(std::list<std::pair<dataptrconst_t, dataptrconst_t>> ranges, ThreadPool& pool) {
     if (ranges.size() != columns.size()) {
         throw std::runtime_error("Number of ranges does not match the number of columns!");
     }
 
-    auto iterRanges = ranges.cbegin();
-    auto iterColumns = columns.begin();
-    while (iterRanges != ranges.cend()) {
-        const auto& p = *iterRanges;
-        auto& c = *iterColumns;
-
-        c->add(p.first, p.second);
+    std::vector<const std::pair<dataptrconst_t, dataptrconst_t>*> items;
+    std::size_t bytes = 0;
+    for (const auto& p : ranges) {
+        bytes += static_cast<std::size_t>(*p.second - *p.first) * columns[items.size()]->getType()->getSize();
+        items.push_back(&p);
+    }
 
-        ++iterRanges;
-        ++iterColumns;
+    // columns do not share any state except the provider
+    if (provider->isThreadSafe() && (columns.size() > 1) && (bytes >= parallelIngestBytes)) {
+        pool.parallelFor(columns.size(), [this, &items](std::size_t i, std::size_t) {
+            columns[i]->add(items[i]->first, items[i]->second);
+        });
+    } else {
+        for (std::size_t i = 0; i < columns.size(); ++i) {
+            columns[i]->add(items[i]->first, items[i]->second);
+        }
     }
 }
 
-struct FreeDeleter {
-    void operator()(void* ptr) {
-        free(ptr);
+void Table::addRows(const dataptrconst_t& begin, const dataptrconst_t& end) {
+    if (!std::dynamic_pointer_cast<const CombinedPtr>(begin)) {
+        throw std::runtime_error("Rows have to be tuples!");
     }
-};
+    auto nRows = static_cast<std::size_t>(*end - *begin);
+    const char* rows = static_cast<const char*>(begin->get());
+    std::vector<std::vector<char>> buffers(columns.size());
+
+    while (nRows > 0) {
+        // filled tails get completed first, so segment boundaries stay at multiples of <chunkRows>
+        std::size_t n = std::min(nRows, Column::chunkRows);
+        bool tailsEmpty = true;
+        for (const auto& c : columns) {
+            if (c->getTailRows() > 0) {
+                tailsEmpty = false;
+                n = std::min(n, Column::chunkRows - c->getTailRows());
+            }
+        }
 
-void Table::addRows(const dataptrconst_t& begin, const dataptrconst_t& end) {
-    auto nElements = static_cast<std::size_t>(*end - *begin);
+        if (tailsEmpty && (n == Column::chunkRows)) {
+            adoptRows(rows, n);
+        } else {
+            stageRows(rows, n, buffers);
+        }
 
-    // allocate memory
-    std::list<std::unique_ptr<void, FreeDeleter>> mems; // mem guard
-    std::list<std::pair<dataptrconst_t, dataptrconst_t>> ranges;
-    for (const auto& c : columns) {
-        auto t = c->getType();
-        void* mem = malloc(t->getSize() * nElements);
-        mems.push_back(std::unique_ptr<void, FreeDeleter>(mem));
-        ranges.push_back(std::make_pair(t->createPtr(mem), t->createPtr(mem)));
-    }
-
-    // rearrange data
-    std::shared_ptr<const CombinedPtr> rowIter = std::dynamic_pointer_cast<const CombinedPtr>(begin);
-    for (std::size_t i = 0; i < nElements; ++i) {
-        std::size_t cIdx = 0;
-        for (auto& p : ranges) {
-            auto sub = rowIter->getSubPtr(cIdx);
-            memcpy(p.second->get(), sub->get(), columns[i]->getType()->getSize());
-            p.second = *p.second + 1;
-
-            ++cIdx;
+        rows += n * rowType->getSize();
+        nRows -= n;
+    }
+}
+
+void Table::adoptRows(const char* rows, std::size_t n) {
+    // rows get transposed directly into provider memory
+    std::vector<Column::Chunk> chunks;
+    std::vector<void*> targets;
+    try {
+        for (const auto& c : columns) {
+            chunks.push_back(c->allocateChunk(n));
+            targets.push_back(chunks.back().data);
         }
 
-        rowIter = std::dynamic_pointer_cast<const CombinedPtr>(*rowIter + 1);
+        transposeRows(rows, n, rowType->getSize(), offsets, sizes, targets);
+    } catch (...) {
+        for (std::size_t i = 0; i < chunks.size(); ++i) {
+            columns[i]->discardChunk(chunks[i]);
+        }
+        throw;
     }
 
-    // add
-    addColumnRanges(ranges);
+    // columns cannot give rows back, so a failing column leaves the table inconsistent, but leaks no chunks
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+        try {
+            columns[i]->adoptChunk(chunks[i], true);
+        } catch (...) {
+            for (std::size_t j = i + 1; j < columns.size(); ++j) {
+                columns[j]->discardChunk(chunks[j]);
+            }
+            throw;
+        }
+    }
+}
 
-    // data get freed here by unique_ptr
+void Table::stageRows(const char* rows, std::size_t n, std::vector<std::vector<char>>& buffers) {
+    std::vector<void*> targets;
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+        buffers[i].resize(n * sizes[i]);
+        targets.push_back(buffers[i].data());
+    }
+
+    transposeRows(rows, n, rowType->getSize(), offsets, sizes, targets);
+
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+        typeptr_t t = columns[i]->getType();
+        columns[i]->add(t->createPtr(static_cast<const void*>(buffers[i].data())), t->createPtr(static_cast<const void*>(buffers[i].data() + n * sizes[i])));
+    }
 }
 
+void Table::flush() {
+    for (auto& c : columns) {
+        c->flush();
+    }
+}
+
+Table::Cursor Table::scan(const std::vector<std::size_t>& projection, std::size_t batchRows) const {
+    if (projection.empty()) {
+        throw std::runtime_error("Projection is empty!");
+    }
+
+    std::vector<Column::Cursor> cursors;
+    std::vector<std::size_t> elementSizes;
+    std::size_t rows = columns.at(projection.front())->size();
+    for (std::size_t i : projection) {
+        const column_t& c = columns.at(i);
+        if (c->size() != rows) {
+            throw std::runtime_error("Columns have different sizes!");
+        }
+
+        cursors.push_back(c->scan());
+        elementSizes.push_back(c->getType()->getSize());
+    }
+
+    return Cursor(std::move(cursors), std::move(elementSizes), rows, std::max<std::size_t>(1, batchRows));
+}
@@ -3,22 +3,136 @@
 
 #include <vector>
 
+#include "../compute/threadpool.hpp"
+#include "../datatypes/tuple.hpp"
 #include "column.hpp"
 
 namespace fluxcore {
 
+/* Set of columns with the same number of rows
+ *
+ * Ingest of large batches fans out over the columns if the provider is thread-safe, e.g. a <SynchronizedProvider>.
+ */
 class Table {
     public:
+        /* Minimal number of bytes per call of <addColumnRanges> that get ingested in parallel
+         */
+        static constexpr std::size_t parallelIngestBytes = 1024 * 1024;
+
+        /* Rows of the same row range in several columns
+         *
+         * <data[i]> holds <rowCount> values of the <i>-th projected column.
+         */
+        struct Batch {
+            std::size_t firstRow;
+            std::size_t rowCount;
+            std::vector<const void*> data;
+        };
+
+        /* Cursor that walks the rows of a projection in aligned batches
+         *
+         * Every batch has the requested number of rows, only the last one can be smaller. Columns whose current span
+         * covers the whole batch are passed without copying, the others get assembled in a buffer of the cursor. The
+         * cursor gets invalidated by every modification of the table, batches are only valid until the next call of
+         * <next>.
+         */
+        class Cursor {
+            public:
+                /* Moves to the next batch
+                 *
+                 * @batch receives the next batch
+                 *
+                 * @return <false> if the end of the table was reached
+                 */
+                bool next(Batch& batch);
+
+            private:
+                friend class Table;
+
+                std::vector<Column::Cursor> cursors;
+                std::vector<Column::Span> spans;
+                std::vector<std::size_t> elementSizes;
+                std::vector<std::vector<char>> buffers;
+                std::size_t nextRow;
+                std::size_t lastRow;
+                std::size_t batchRows;
+
+                Cursor(std::vector<Column::Cursor>&& cursors_, std::vector<std::size_t>&& elementSizes_, std::size_t lastRow_, std::size_t batchRows_);
+
+                /* Returns the unread rows of the current span of column <i>, moves to the next span if there are none
+                 */
+                std::size_t available(std::size_t i);
+
+                /* Marks <n> rows of the current span of column <i> as read
+                 */
+                void consume(std::size_t i, std::size_t n);
+        };
+
         Table(const std::list<typeptr_t>& columns_, const provider_t& provider_);
         Table(const std::list<std::pair<typeptr_t, std::size_t>>& columns_, const provider_t& provider_);
 
         column_t getColumn(std::size_t i) const;
+        std::size_t getColumnCount() const;
 
-        void addColumnRanges(std::list<std::pair<dataptrconst_t, dataptrconst_t>> ranges);
+        /* Returns the <Tuple> of all column types, which describes the rows of <addRows>
+         */
+        typeptr_t getRowType() const;
+
+        /* Appends one range of values per column
+         *
+         * @ranges (begin, end) pointers, one pair per column
+         * @pool workers used for the parallel ingest
+         *
+         * If the provider is thread-safe and the ranges hold at least <parallelIngestBytes>, every column gets
+         * appended by its own task of <pool>.
+         */
+        void addColumnRanges(std::list<std::pair<dataptrconst_t, dataptrconst_t>> ranges, ThreadPool& pool = ThreadPool::getDefault());
+
+        /* Appends rows of <getRowType()>
+         *
+         * @begin pointer to the first row
+         * @end pointer behind the last row
+         *
+         * The rows get transposed block-wise, see <transposeRows>, using the offsets of the row type. Runs of
+         * <Column::chunkRows> rows are transposed directly into chunks of the columns and adopted when all tails are
+         * empty. Everything else is transposed into staging buffers and appended to the tails, so small batches do not
+         * fragment the columns. No memory gets allocated per row or value.
+         *
+         * Warning: If a column fails to take a run of rows (e.g. because the provider runs out of space), the columns
+         * before it keep the run and the table is left with columns of different sizes!
+         */
         void addRows(const dataptrconst_t& begin, const dataptrconst_t& end);
 
+        /* Seals the tails of all columns, see <Column::flush>
+         */
+        void flush();
+
+        /* Creates a cursor over some columns of the table
+         *
+         * @projection indices of the columns that get scanned, in the order of <Batch::data>
+         * @batchRows number of rows per batch
+         *
+         * The segment boundaries of the projected columns do not have to match. Throws if the projection is empty or
+         * the columns have different sizes.
+         */
+        Cursor scan(const std::vector<std::size_t>& projection, std::size_t batchRows = Column::blockRows) const;
+
     private:
+        provider_t provider;
         std::vector<column_t> columns;
+        std::shared_ptr<Tuple> rowType;
+        std::vector<std::size_t> offsets;
+        std::vector<std::size_t> sizes;
+
+        void init();
+
+        /* Transposes <n> rows into one chunk per column and adopts the chunks
+         */
+        void adoptRows(const char* rows, std::size_t n);
+
+        /* Transposes <n> rows into <buffers> and appends them to the tails of the columns
+         */
+        void stageRows(const char* rows, std::size_t n, std::vector<std::vector<char>>& buffers);
 };
 
 typedef std::shared_ptr<Table> table_t;
@@ -0,0 +1,51 @@
+#include "transpose.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace fluxcore;
+
+template <std::size_t size>
+static void copyField(const char* src, std::size_t n, std::size_t stride, char* dst) {
+    for (std::size_t r = 0; r < n; ++r) {
+        memcpy(dst + r * size, src + r * stride, size);
+    }
+}
+
+static void copyField(const char* src, std::size_t n, std::size_t stride, std::size_t size, char* dst) {
+    for (std::size_t r = 0; r < n; ++r) {
+        memcpy(dst + r * size, src + r * stride, size);
+    }
+}
+
+void fluxcore::transposeRows(const void* rows, std::size_t nRows, std::size_t rowSize, const std::vector<std::size_t>& offsets, const std::vector<std::size_t>& sizes, const std::vector<void*>& targets) {
+    const char* base = static_cast<const char*>(rows);
+    std::size_t blockRows = std::max<std::size_t>(1, transposeBlockBytes / std::max<std::size_t>(1, rowSize));
+
+    for (std::size_t first = 0; first < nRows; first += blockRows) {
+        std::size_t n = std::min(blockRows, nRows - first);
+        const char* block = base + first * rowSize;
+
+        for (std::size_t i = 0; i < offsets.size(); ++i) {
+            const char* src = block + offsets[i];
+            char* dst = static_cast<char*>(targets[i]) + first * sizes[i];
+
+            switch (sizes[i]) {
+                case 1:
+                    copyField<1>(src, n, rowSize, dst);
+                    break;
+                case 2:
+                    copyField<2>(src, n, rowSize, dst);
+                    break;
+                case 4:
+                    copyField<4>(src, n, rowSize, dst);
+                    break;
+                case 8:
+                    copyField<8>(src, n, rowSize, dst);
+                    break;
+                default:
+                    copyField(src, n, rowSize, sizes[i], dst);
+            }
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef FLUXCORE_TRANSPOSE_HPP
+#define FLUXCORE_TRANSPOSE_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace fluxcore {
+
+/* Bytes of rows that get transposed at once, small enough to stay in the L1 cache
+ */
+constexpr std::size_t transposeBlockBytes = 16 * 1024;
+
+/* Scatters packed rows into one array per field
+ *
+ * @rows packed rows, field <i> of row <r> starts at <rows + r * rowSize + offsets[i]>
+ * @nRows number of rows
+ * @rowSize size of a single row
+ * @offsets offset of every field inside a row, e.g. the offsets of a <Tuple>
+ * @sizes size of every field
+ * @targets one array per field, receives <nRows> values of <sizes[i]> bytes
+ *
+ * Rows are processed in blocks of <transposeBlockBytes>. Within a block the fields get copied one after another,
+ * so every target is written sequentially while the strided reads hit cache lines that were loaded for the previous
+ * field. Fields of 1, 2, 4 and 8 bytes are copied with fixed-size moves.
+ */
+void transposeRows(const void* rows, std::size_t nRows, std::size_t rowSize, const std::vector<std::size_t>& offsets, const std::vector<std::size_t>& sizes, const std::vector<void*>& targets);
+
+}
+
+#endif
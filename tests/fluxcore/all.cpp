@@ -2,6 +2,7 @@
 
 void test_fluxcore() {
     test_datatypes();
+    test_compute();
     test_storage();
 }
 
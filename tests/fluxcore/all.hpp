@@ -1,6 +1,7 @@
 #ifndef TESTS_FLUXCORE_ALL_HPP
 #define TESTS_FLUXCORE_ALL_HPP
 
+void test_compute();
 void test_datatypes();
 void test_storage();
 
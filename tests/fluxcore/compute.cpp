@@ -0,0 +1,370 @@
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include <bandit/bandit.h>
+#include <fluxcore/compute/aggregate.hpp>
+#include <fluxcore/compute/filter.hpp>
+#include <fluxcore/compute/parallel.hpp>
+#include <fluxcore/compute/threadpool.hpp>
+#include <fluxcore/datatypes/byte.hpp>
+#include <fluxcore/datatypes/float.hpp>
+#include <fluxcore/datatypes/int.hpp>
+#include <fluxcore/storage/provider/inmemoryprovider.hpp>
+
+using namespace bandit;
+using namespace fluxcore;
+
+// appends <values> to <column> in batches of <batch> rows
+template <typename T>
+static void fill(Column& column, const std::vector<T>& values, std::size_t batch) {
+    auto t = column.getType();
+    for (std::size_t i = 0; i < values.size(); i += batch) {
+        std::size_t n = std::min(batch, values.size() - i);
+        column.add(t->createPtr(static_cast<const void*>(values.data() + i)), t->createPtr(static_cast<const void*>(values.data() + i + n)));
+    }
+}
+
+void test_compute() {
+    go_bandit([](){
+        describe("aggregate", [](){
+            it("aggregates Int columns", [](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Column column(std::make_shared<Int>(), provider);
+                std::vector<int_t> values;
+                for (std::size_t i = 0; i < 200003; ++i) {
+                    values.push_back(static_cast<int_t>((i * 7919) % 100003) - 50000);
+                }
+                fill(column, values, 777);
+
+                int_t sum = 0;
+                for (int_t v : values) {
+                    sum += v;
+                }
+
+                Aggregate<int_t> result = aggregate<Int>(column);
+                AssertThat(result.count, Equals(values.size()));
+                AssertThat(result.sum, Equals(sum));
+                AssertThat(result.min, Equals(static_cast<int_t>(-50000)));
+                AssertThat(result.max, Equals(static_cast<int_t>(50002)));
+                AssertThat(result.avg(), EqualsWithDelta(static_cast<double>(sum) / values.size(), 1e-9));
+            });
+
+            it("aggregates Float and Byte columns", [](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Column floats(std::make_shared<Float>(), provider);
+                Column bytes(std::make_shared<Byte>(), provider);
+                std::vector<double> fv;
+                std::vector<byte_t> bv;
+                for (std::size_t i = 0; i < 1001; ++i) {
+                    fv.push_back(static_cast<double>(i) * 0.5 - 100.0);
+                    bv.push_back(static_cast<byte_t>(i % 251));
+                }
+                fill(floats, fv, 10);
+                fill(bytes, bv, 1001);
+
+                Aggregate<double> f = aggregate<Float>(floats);
+                AssertThat(f.count, Equals(static_cast<std::size_t>(1001)));
+                AssertThat(f.sum, EqualsWithDelta(1001 * 250.0 - 100100.0, 1e-6));
+                AssertThat(f.min, Equals(-100.0));
+                AssertThat(f.max, Equals(400.0));
+
+                Aggregate<byte_t> b = aggregate<Byte>(bytes);
+                std::uint64_t sum = 0;
+                for (byte_t v : bv) {
+                    sum += v;
+                }
+                AssertThat(b.sum, Equals(sum));
+                AssertThat(b.min, Equals(static_cast<byte_t>(0)));
+                AssertThat(b.max, Equals(static_cast<byte_t>(250)));
+            });
+
+            it("handles empty columns and wrong types", [](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Column column(std::make_shared<Int>(), provider);
+
+                Aggregate<int_t> result = aggregate<Int>(column);
+                AssertThat(result.count, Equals(static_cast<std::size_t>(0)));
+                AssertThat(std::isnan(result.avg()), IsTrue());
+                AssertThrows(std::runtime_error, aggregate<Float>(column));
+            });
+
+            it("merges partial results", [](){
+                std::vector<int_t> values{5, -3, 9, 0, 12, -7, 4};
+                Aggregate<int_t> a;
+                Aggregate<int_t> b;
+                aggregateSpan(values.data(), 3, a);
+                aggregateSpan(values.data() + 3, 4, b);
+                a.merge(b);
+
+                AssertThat(a.count, Equals(static_cast<std::size_t>(7)));
+                AssertThat(a.sum, Equals(static_cast<int_t>(20)));
+                AssertThat(a.min, Equals(static_cast<int_t>(-7)));
+                AssertThat(a.max, Equals(static_cast<int_t>(12)));
+            });
+        });
+
+        describe("filter", [](){
+            // compares <filter> and <selectRows> with a scalar evaluation of <pred>
+            auto check = [](const Column& column, const std::vector<int_t>& values, const Predicate<int_t>& p, std::function<bool(int_t)> pred) {
+                Bitmap bitmap = filter<Int>(column, p);
+                Selection expected;
+                for (std::size_t i = 0; i < values.size(); ++i) {
+                    if (pred(values[i])) {
+                        expected.push_back(i);
+                    }
+                }
+
+                AssertThat(bitmap.size(), Equals(values.size()));
+                AssertThat(bitmap.count(), Equals(expected.size()));
+                AssertThat(bitmap.toSelection() == expected, IsTrue());
+                AssertThat(selectRows<Int>(column, p) == expected, IsTrue());
+            };
+
+            it("evaluates comparisons on unaligned spans", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Column column(std::make_shared<Int>(), provider);
+                std::vector<int_t> values;
+                for (std::size_t i = 0; i < 150001; ++i) {
+                    values.push_back(static_cast<int_t>((i * 7919) % 1009) - 500);
+                }
+                // odd batch sizes and flushes seal segments at arbitrary row counts
+                for (std::size_t i = 0; i < values.size(); i += 50003) {
+                    std::size_t n = std::min<std::size_t>(50003, values.size() - i);
+                    std::vector<int_t> part(values.begin() + i, values.begin() + i + n);
+                    fill(column, part, 333);
+                    column.flush();
+                }
+
+                check(column, values, Predicate<int_t>::equal(7), [](int_t v) { return v == 7; });
+                check(column, values, Predicate<int_t>::less(-250), [](int_t v) { return v < -250; });
+                check(column, values, Predicate<int_t>::lessEqual(0), [](int_t v) { return v <= 0; });
+                check(column, values, Predicate<int_t>::greater(400), [](int_t v) { return v > 400; });
+                check(column, values, Predicate<int_t>::greaterEqual(508), [](int_t v) { return v >= 508; });
+                check(column, values, Predicate<int_t>::between(-10, 10), [](int_t v) { return v >= -10 && v <= 10; });
+                check(column, values, Predicate<int_t>::between(10, -10), [](int_t) { return false; });
+            });
+
+            it("evaluates IN lists", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Column column(std::make_shared<Int>(), provider);
+                std::vector<int_t> values;
+                for (std::size_t i = 0; i < 10000; ++i) {
+                    values.push_back(static_cast<int_t>(i % 97));
+                }
+                fill(column, values, 1000);
+
+                check(column, values, Predicate<int_t>::in({3, 5, 3, 96}), [](int_t v) { return v == 3 || v == 5 || v == 96; });
+
+                std::vector<int_t> odd;
+                for (int_t v = 1; v < 200; v += 2) {
+                    odd.push_back(v);
+                }
+                check(column, values, Predicate<int_t>::in(odd), [](int_t v) { return v % 2 == 1; });
+                check(column, values, Predicate<int_t>::in({}), [](int_t) { return false; });
+            });
+
+            it("prunes segments with zone maps", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Column column(std::make_shared<Int>(), provider);
+                std::vector<int_t> values;
+                for (std::size_t i = 0; i < 5 * Column::chunkRows + 123; ++i) {
+                    values.push_back(static_cast<int_t>(i / 3));
+                }
+                fill(column, values, 10000);
+
+                std::size_t lo = Column::chunkRows / 3 + 5;
+                std::size_t hi = 4 * Column::chunkRows / 3;
+                check(column, values, Predicate<int_t>::between(lo, hi), [&](int_t v) { return v >= static_cast<int_t>(lo) && v <= static_cast<int_t>(hi); });
+                check(column, values, Predicate<int_t>::less(static_cast<int_t>(values.size())), [](int_t) { return true; });
+                check(column, values, Predicate<int_t>::greater(static_cast<int_t>(values.size())), [](int_t) { return false; });
+                check(column, values, Predicate<int_t>::equal(values.back()), [&](int_t v) { return v == values.back(); });
+                check(column, values, Predicate<int_t>::in({0, 21845, 21846, 21847, 100000}), [](int_t v) { return v == 0 || v == 21845 || v == 21846 || v == 21847 || v == 100000; });
+            });
+
+            it("does not prune segments with NaN", [](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Column column(std::make_shared<Float>(), provider);
+                std::vector<double> values{1.0, 2.0, std::nan(""), 3.0};
+                fill(column, values, 4);
+                column.flush();
+                fill(column, std::vector<double>{5.0, 6.0}, 2);
+                column.flush();
+
+                std::vector<Column::Zone> zones = column.zones();
+                AssertThat(zones.size(), Equals(static_cast<std::size_t>(2)));
+                AssertThat(zones[0].hasRange, IsFalse());
+                AssertThat(zones[1].hasRange, IsTrue());
+                AssertThat(selectRows<Float>(column, Predicate<double>::between(0.0, 10.0)) == Selection({0, 1, 3, 4, 5}), IsTrue());
+            });
+
+            it("combines bitmaps and selections", [](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Column column(std::make_shared<Int>(), provider);
+                std::vector<int_t> values;
+                for (std::size_t i = 0; i < 1000; ++i) {
+                    values.push_back(static_cast<int_t>(i));
+                }
+                fill(column, values, 1000);
+
+                Bitmap a = filter<Int>(column, Predicate<int_t>::less(600));
+                Bitmap b = filter<Int>(column, Predicate<int_t>::greaterEqual(400));
+                AssertThat((a & b).count(), Equals(static_cast<std::size_t>(200)));
+                AssertThat((a | b).count(), Equals(static_cast<std::size_t>(1000)));
+
+                Selection sa = a.toSelection();
+                Selection sb = b.toSelection();
+                AssertThat((sa & sb) == (a & b).toSelection(), IsTrue());
+                AssertThat((sa | sb) == (a | b).toSelection(), IsTrue());
+
+                AssertThrows(std::runtime_error, a &= Bitmap(999));
+            });
+
+            it("filters Float columns", [](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Column column(std::make_shared<Float>(), provider);
+                std::vector<double> values{1.5, std::nan(""), -2.0, 3.25, 1.5};
+                fill(column, values, 5);
+
+                AssertThat(selectRows<Float>(column, Predicate<double>::equal(1.5)) == Selection({0, 4}), IsTrue());
+                AssertThat(selectRows<Float>(column, Predicate<double>::lessEqual(1.5)) == Selection({0, 2, 4}), IsTrue());
+                AssertThrows(std::runtime_error, filter<Int>(column, Predicate<int_t>::equal(1)));
+            });
+        });
+
+        describe("ThreadPool", [](){
+            it("runs every task once", [](){
+                ThreadPool pool(4);
+                AssertThat(pool.size(), Equals(static_cast<std::size_t>(4)));
+
+                std::vector<std::atomic<int>> runs(1000);
+                for (auto& r : runs) {
+                    r = 0;
+                }
+                std::atomic<bool> workerInRange(true);
+                pool.parallelFor(runs.size(), [&](std::size_t i, std::size_t worker) {
+                    ++runs[i];
+                    if (worker >= 4) {
+                        workerInRange = false;
+                    }
+                });
+
+                for (auto& r : runs) {
+                    AssertThat(r.load(), Equals(1));
+                }
+                AssertThat(workerInRange.load(), IsTrue());
+                pool.parallelFor(0, [](std::size_t, std::size_t) {});
+            });
+
+            it("supports nested loops", [](){
+                ThreadPool pool(2);
+                std::atomic<std::size_t> sum(0);
+                pool.parallelFor(8, [&](std::size_t i, std::size_t) {
+                    pool.parallelFor(8, [&](std::size_t j, std::size_t) {
+                        sum += i * 8 + j;
+                    });
+                });
+                AssertThat(sum.load(), Equals(static_cast<std::size_t>(64 * 63 / 2)));
+            });
+
+            it("rethrows exceptions of tasks", [](){
+                ThreadPool pool(3);
+                std::atomic<std::size_t> finished(0);
+                AssertThrows(std::runtime_error, pool.parallelFor(50, [&](std::size_t i, std::size_t) {
+                    if (i == 17) {
+                        throw std::runtime_error("Task failed!");
+                    }
+                    ++finished;
+                }));
+                AssertThat(finished.load(), Equals(static_cast<std::size_t>(49)));
+            });
+        });
+
+        describe("parallel", [](){
+            it("aggregates and filters with multiple workers", [](){
+                ThreadPool pool(4);
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Column column(std::make_shared<Int>(), provider);
+                std::vector<int_t> values;
+                for (std::size_t i = 0; i < 300007; ++i) {
+                    values.push_back(static_cast<int_t>((i * 7919) % 100003) - 50000 + static_cast<int_t>(i / 1000));
+                }
+                // flushes leave segment boundaries that are not word aligned
+                for (std::size_t i = 0; i < values.size(); i += 40009) {
+                    std::size_t n = std::min<std::size_t>(40009, values.size() - i);
+                    fill(column, std::vector<int_t>(values.begin() + i, values.begin() + i + n), 4000);
+                    column.flush();
+                }
+                fill(column, std::vector<int_t>{1, 2, 3}, 3);
+                values.push_back(1);
+                values.push_back(2);
+                values.push_back(3);
+
+                Aggregate<int_t> serial = aggregate<Int>(column);
+                Aggregate<int_t> parallel = parallelAggregate<Int>(column, pool);
+                AssertThat(parallel.count, Equals(serial.count));
+                AssertThat(parallel.sum, Equals(serial.sum));
+                AssertThat(parallel.min, Equals(serial.min));
+                AssertThat(parallel.max, Equals(serial.max));
+
+                std::vector<Predicate<int_t>> predicates{Predicate<int_t>::less(0), Predicate<int_t>::between(-100, 100), Predicate<int_t>::greaterEqual(-60000)};
+                for (const auto& p : predicates) {
+                    AssertThat(parallelFilter<Int>(column, p, pool).toSelection() == filter<Int>(column, p).toSelection(), IsTrue());
+                }
+                AssertThrows(std::runtime_error, parallelAggregate<Float>(column, pool));
+            });
+
+            it("splits tables along segment boundaries", [](){
+                ThreadPool pool(3);
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Table table({std::make_shared<Int>(), std::make_shared<Int>()}, provider);
+                std::vector<int_t> a;
+                std::vector<int_t> b;
+                for (std::size_t i = 0; i < 10000; ++i) {
+                    a.push_back(static_cast<int_t>(i));
+                    b.push_back(static_cast<int_t>(i % 10));
+                }
+                fill(*table.getColumn(0), a, 10000);
+                table.getColumn(0)->flush();
+                fill(*table.getColumn(1), std::vector<int_t>(b.begin(), b.begin() + 3000), 3000);
+                table.getColumn(1)->flush();
+                fill(*table.getColumn(1), std::vector<int_t>(b.begin() + 3000, b.end()), 7000);
+                table.getColumn(1)->flush();
+                fill(*table.getColumn(0), a, 10000);
+                fill(*table.getColumn(1), b, 10000);
+
+                std::vector<Morsel> parts = morsels(table);
+                std::vector<std::size_t> bounds;
+                for (const Morsel& m : parts) {
+                    bounds.push_back(m.firstRow + m.rowCount);
+                }
+                AssertThat(bounds == std::vector<std::size_t>({3000, 10000, 20000}), IsTrue());
+
+                // SELECT SUM(a) WHERE b = 7
+                std::vector<int_t> sums(pool.size(), 0);
+                pool.parallelFor(parts.size(), [&](std::size_t i, std::size_t worker) {
+                    std::vector<int_t> keys(parts[i].rowCount);
+                    scanMorsel(*table.getColumn(1), parts[i], [&](const Column::Span& span) {
+                        memcpy(keys.data() + (span.firstRow - parts[i].firstRow), span.data, span.rowCount * sizeof(int_t));
+                    });
+                    scanMorsel(*table.getColumn(0), parts[i], [&](const Column::Span& span) {
+                        const int_t* values = static_cast<const int_t*>(span.data);
+                        for (std::size_t j = 0; j < span.rowCount; ++j) {
+                            if (keys[span.firstRow - parts[i].firstRow + j] == 7) {
+                                sums[worker] += values[j];
+                            }
+                        }
+                    });
+                });
+
+                int_t total = 0;
+                for (int_t s : sums) {
+                    total += s;
+                }
+                AssertThat(total, Equals(static_cast<int_t>(2 * (1000 * 7 + 10 * 999 * 1000 / 2))));
+            });
+        });
+    });
+}
@@ -1,12 +1,63 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <ftw.h>
+#include <map>
+#include <set>
 #include <sstream>
+#include <thread>
+#include <unistd.h>
 
 #include <bandit/bandit.h>
+#include <fluxcore/config.hpp>
+#include <fluxcore/datatypes/bool.hpp>
+#include <fluxcore/datatypes/byte.hpp>
+#include <fluxcore/datatypes/float.hpp>
+#include <fluxcore/datatypes/int.hpp>
+#include <fluxcore/datatypes/tuple.hpp>
+#include <fluxcore/storage/provider/bufferpoolprovider.hpp>
 #include <fluxcore/storage/provider/inmemoryprovider.hpp>
+#include <fluxcore/storage/provider/mmapfileprovider.hpp>
+#include <fluxcore/storage/provider/shardedprovider.hpp>
+#include <fluxcore/storage/provider/slabprovider.hpp>
+#include <fluxcore/storage/provider/synchronizedprovider.hpp>
+#include <fluxcore/storage/column.hpp>
+#include <fluxcore/storage/concurrentindex.hpp>
+#include <fluxcore/storage/encoding.hpp>
 #include <fluxcore/storage/index.hpp>
+#include <fluxcore/storage/keysearch.hpp>
+#include <fluxcore/storage/table.hpp>
+#include <fluxcore/storage/transpose.hpp>
 
 using namespace bandit;
 using namespace fluxcore;
 
+/* Creates a fresh directory below /tmp and removes it including its content on destruction
+ */
+class TempDir {
+    public:
+        TempDir() {
+            char tmpl[] = "/tmp/fluxtest-XXXXXX";
+            if (mkdtemp(tmpl) == nullptr) {
+                throw std::runtime_error("Could not create temporary directory!");
+            }
+            path = tmpl;
+        }
+
+        TempDir(const TempDir&) = delete;
+        TempDir& operator=(const TempDir&) = delete;
+
+        ~TempDir() {
+            nftw(path.c_str(), [](const char* file, const struct stat*, int, struct FTW*) {
+                return remove(file);
+            }, 16, FTW_DEPTH | FTW_PHYS);
+        }
+
+        std::string path;
+};
+
 void test_storage() {
     go_bandit([](){
         describe("InmemoryProvider", [](){
@@ -40,6 +91,7 @@ void test_storage() {
 
                         AssertThat(s.id(), IsGreaterThan(static_cast<std::size_t>(0)));
                         AssertThat(s.size(), Equals(bin.second));
+                        AssertThat(reinterpret_cast<std::uintptr_t>(s.ptr()) % AbstractProvider::segmentAlignment, Equals(static_cast<std::uintptr_t>(0)));
 
                         record.insert(std::make_pair(bin.first, std::move(s)));
                     });
@@ -61,6 +113,546 @@ void test_storage() {
             }
         });
 
+        describe("InmemoryProvider directory", [](){
+            it("reuses slots and rejects stale ids", [](){
+                InmemoryProvider provider;
+                Segment a = provider.createSegment(16);
+                provider.freeSegment(a.id());
+
+                Segment b = provider.createSegment(32);
+                AssertThat(b.id() != a.id(), IsTrue());
+                AssertThat(b.id() & 0xffffffff, Equals(a.id() & 0xffffffff));
+                AssertThrows(std::runtime_error, provider.getSegment(a.id()));
+                AssertThrows(std::runtime_error, provider.freeSegment(a.id()));
+                AssertThrows(std::runtime_error, provider.getSegment(0));
+                AssertThrows(std::runtime_error, provider.getSegment(b.id() + 1));
+                AssertThat(provider.getSegment(b.id()).size(), Equals(static_cast<std::size_t>(32)));
+            });
+
+            it("spans multiple chunks", [](){
+                InmemoryProvider provider;
+                std::vector<Segment> segments;
+                for (std::size_t i = 0; i < 3 * InmemoryProvider::chunkSize; ++i) {
+                    segments.push_back(provider.createSegment(i % 128));
+                }
+                for (std::size_t i = 0; i < segments.size(); i += 3) {
+                    provider.freeSegment(segments[i].id());
+                }
+
+                for (std::size_t i = 0; i < segments.size(); ++i) {
+                    if (i % 3 == 0) {
+                        AssertThrows(std::runtime_error, provider.getSegment(segments[i].id()));
+                    } else {
+                        Segment s = provider.getSegment(segments[i].id());
+                        AssertThat(s.ptr(), Equals(segments[i].ptr()));
+                        AssertThat(s.size(), Equals(i % 128));
+                    }
+                }
+            });
+        });
+
+        describe("MmapFileProvider", [](){
+            TempDir dir;
+            std::string path = dir.path + "/db";
+            std::map<std::size_t, std::pair<std::size_t, std::size_t>> record; // id => (size, pattern)
+            std::size_t indexID = 0;
+
+            it("creates segments of different sizes", [&](){
+                std::shared_ptr<MmapFileProvider> provider = std::make_shared<MmapFileProvider>(path, 64 * 1024);
+                AssertThat(provider->getRootID(), Equals(static_cast<std::size_t>(0)));
+
+                std::vector<std::size_t> sizes{0, 1, 20, 4096, 7, 1024 * 1024, 100, 5000};
+                for (std::size_t i = 0; i < sizes.size(); ++i) {
+                    Segment s = provider->createSegment(sizes[i]);
+                    AssertThat(s.id(), IsGreaterThan(static_cast<std::size_t>(0)));
+                    AssertThat(s.size(), Equals(sizes[i]));
+                    memset(s.ptr(), static_cast<int>(i + 1), s.size());
+                    record.insert(std::make_pair(s.id(), std::make_pair(sizes[i], i + 1)));
+                }
+
+                provider->setRootID(record.begin()->first);
+            });
+
+            it("reuses freed space", [&](){
+                MmapFileProvider provider(path);
+                auto victim = record.find(provider.getRootID());
+                ++victim;
+                ++victim;
+
+                Segment old = provider.getSegment(victim->first);
+                provider.freeSegment(victim->first);
+                record.erase(victim);
+
+                Segment s = provider.createSegment(20);
+                AssertThat(s.id(), Equals(old.id()));
+                AssertThat(s.ptr(), Equals(old.ptr()));
+                memset(s.ptr(), 42, s.size());
+                record.insert(std::make_pair(s.id(), std::make_pair(static_cast<std::size_t>(20), static_cast<std::size_t>(42))));
+            });
+
+            it("stores an index", [&](){
+                provider_t provider = std::make_shared<MmapFileProvider>(path);
+                Index<std::size_t, 4> index(provider);
+                for (std::size_t i = 1; i <= 100; ++i) {
+                    index.insert(i * 3, i);
+                }
+                indexID = index.getID();
+            });
+
+            it("restores segments after reopening", [&](){
+                MmapFileProvider provider(path);
+                AssertThat(provider.getRootID(), Equals(record.begin()->first));
+
+                for (const auto& r : record) {
+                    Segment s = provider.getSegment(r.first);
+                    AssertThat(s.size(), Equals(r.second.first));
+                    for (std::size_t i = 0; i < s.size(); ++i) {
+                        AssertThat(static_cast<std::size_t>(static_cast<unsigned char*>(s.ptr())[i]), Equals(r.second.second));
+                    }
+                }
+            });
+
+            it("restores an index after reopening", [&](){
+                provider_t provider = std::make_shared<MmapFileProvider>(path);
+                Index<std::size_t, 4> index(provider, indexID);
+                AssertThat(index.first().first, Equals(static_cast<std::size_t>(3)));
+                AssertThat(index.last().first, Equals(static_cast<std::size_t>(300)));
+                AssertThat(index.last().second, Equals(static_cast<std::size_t>(100)));
+            });
+
+            it("rejects unknown segments", [&](){
+                MmapFileProvider provider(path);
+                AssertThrows(std::runtime_error, provider.getSegment(0));
+                AssertThrows(std::runtime_error, provider.getSegment(100000));
+            });
+
+            it("rejects broken files without leaking descriptors", [&](){
+                // the lowest free descriptor moves if one leaks
+                auto freeFd = []() {
+                    int fd = dup(0);
+                    close(fd);
+                    return fd;
+                };
+                int before = freeFd();
+
+                {
+                    std::ofstream f(dir.path + "/short");
+                    f << "FLUX";
+                }
+                AssertThrows(std::runtime_error, MmapFileProvider(dir.path + "/short"));
+
+                {
+                    MmapFileProvider provider(dir.path + "/broken", 64 * 1024);
+                    for (std::size_t i = 0; i < 3; ++i) {
+                        provider.createSegment(40 * 1024);
+                    }
+                }
+                AssertThat(unlink((dir.path + "/broken.1").c_str()), Equals(0));
+                AssertThrows(std::runtime_error, MmapFileProvider(dir.path + "/broken", 64 * 1024));
+
+                AssertThat(freeFd(), Equals(before));
+            });
+        });
+
+        describe("BufferPoolProvider", [](){
+            TempDir dir;
+            std::string path = dir.path + "/spill";
+
+            it("spills unpinned segments and reads them back", [&](){
+                BufferPoolProvider provider(path, 64 * 1024);
+                std::vector<std::size_t> ids;
+                for (std::size_t i = 0; i < 100; ++i) {
+                    Segment s = provider.createSegment(4000 + i);
+                    memset(s.ptr(), static_cast<int>(i), s.size());
+                    provider.unpinSegment(s.id(), true);
+                    ids.push_back(s.id());
+                    AssertThat(provider.getResidentBytes(), IsLessThan(static_cast<std::size_t>(64 * 1024 + 1)));
+                }
+
+                for (std::size_t round = 0; round < 2; ++round) {
+                    for (std::size_t i = 0; i < ids.size(); ++i) {
+                        SegmentPin pin(&provider, ids[i]);
+                        AssertThat(pin.size(), Equals(4000 + i));
+                        AssertThat(static_cast<int>(static_cast<unsigned char*>(pin.ptr())[0]), Equals(static_cast<int>(i)));
+                        AssertThat(static_cast<int>(static_cast<unsigned char*>(pin.ptr())[pin.size() - 1]), Equals(static_cast<int>(i)));
+                    }
+                }
+                AssertThat(provider.getFaultCount(), IsGreaterThan(static_cast<std::size_t>(100)));
+                AssertThat(provider.getResidentBytes(), IsLessThan(static_cast<std::size_t>(64 * 1024 + 1)));
+            });
+
+            it("keeps pinned segments in place", [&](){
+                BufferPoolProvider provider(path, 16 * 1024);
+                Segment pinned = provider.createSegment(8192);
+                memset(pinned.ptr(), 7, pinned.size());
+
+                for (std::size_t i = 0; i < 50; ++i) {
+                    Segment s = provider.createSegment(4096);
+                    provider.unpinSegment(s.id(), true);
+                }
+                Segment s = provider.getSegment(pinned.id());
+                AssertThat(s.ptr(), Equals(pinned.ptr()));
+                AssertThat(static_cast<int>(static_cast<char*>(s.ptr())[8191]), Equals(7));
+                provider.unpinSegment(s.id(), false);
+
+                // pins exceeding the budget grow the pool instead of failing
+                Segment large = provider.createSegment(64 * 1024);
+                AssertThat(provider.getResidentBytes(), IsGreaterThan(static_cast<std::size_t>(64 * 1024)));
+                provider.freeSegment(large.id());
+            });
+
+            it("merges freed spill ranges", [&](){
+                BufferPoolProvider provider(path, 16 * 1024);
+                for (std::size_t round = 0; round < 20; ++round) {
+                    // a different size every round only fits into the freed ranges of the last round if they get merged
+                    std::size_t size = 4096 * (1 + round % 4);
+                    std::vector<std::size_t> ids;
+                    for (std::size_t i = 0; i < 32; ++i) {
+                        Segment s = provider.createSegment(size);
+                        memset(s.ptr(), static_cast<int>(i), s.size());
+                        provider.unpinSegment(s.id(), true);
+                        ids.push_back(s.id());
+                    }
+                    AssertThat(provider.getSpillBytes(), IsLessThan(32 * size + 1));
+
+                    for (std::size_t i = 0; i < ids.size(); ++i) {
+                        SegmentPin pin(&provider, ids[i]);
+                        AssertThat(static_cast<int>(static_cast<unsigned char*>(pin.ptr())[size - 1]), Equals(static_cast<int>(i)));
+                    }
+                    for (std::size_t id : ids) {
+                        provider.freeSegment(id);
+                    }
+                    AssertThat(provider.getSpillBytes(), Equals(static_cast<std::size_t>(0)));
+                }
+            });
+
+            it("keeps resident segments without counting pins", [&](){
+                BufferPoolProvider provider(path, 16 * 1024);
+                Segment resident = provider.createSegment(4096);
+                memset(resident.ptr(), 3, resident.size());
+                provider.keepResident(resident.id());
+                provider.getSegment(resident.id());
+                provider.getSegment(resident.id());
+
+                for (std::size_t i = 0; i < 50; ++i) {
+                    Segment s = provider.createSegment(4096);
+                    provider.unpinSegment(s.id(), true);
+                }
+                AssertThat(provider.getSegment(resident.id()).ptr(), Equals(resident.ptr()));
+                AssertThat(static_cast<int>(static_cast<char*>(resident.ptr())[4095]), Equals(3));
+                provider.unpinSegment(resident.id(), false);
+
+                // index nodes are kept resident, lookups stay valid while column data gets evicted
+                provider_t shared = std::make_shared<BufferPoolProvider>(path + "-index", 16 * 1024);
+                Index<std::size_t, 4> index(shared);
+                for (std::size_t i = 1; i <= 2000; ++i) {
+                    index.insert(i, i * 2);
+                    Segment s = shared->createSegment(1024);
+                    shared->unpinSegment(s.id(), true);
+                }
+                for (std::size_t i = 1; i <= 2000; ++i) {
+                    AssertThat(index.find(i).record(), Equals(i * 2));
+                }
+
+                provider.freeSegment(resident.id());
+                Segment reused = provider.createSegment(100);
+                provider.unpinSegment(reused.id(), false);
+                AssertThrows(std::runtime_error, provider.unpinSegment(reused.id(), false));
+            });
+
+            it("rejects unknown ids and unbalanced unpins", [&](){
+                BufferPoolProvider provider(path, 16 * 1024);
+                Segment s = provider.createSegment(100);
+                provider.unpinSegment(s.id(), false);
+
+                AssertThrows(std::runtime_error, provider.unpinSegment(s.id(), false));
+                AssertThrows(std::runtime_error, provider.getSegment(s.id() + 1));
+                provider.freeSegment(s.id());
+                AssertThrows(std::runtime_error, provider.getSegment(s.id()));
+            });
+
+            it("scans columns larger than the budget", [&](){
+                std::shared_ptr<BufferPoolProvider> provider = std::make_shared<BufferPoolProvider>(path, 1024 * 1024);
+                Column column(std::make_shared<Int>(), provider);
+                // scrambled values, so the segments stay raw
+                auto value = [](std::size_t row) {
+                    return static_cast<int_t>((row * 0x9e3779b97f4a7c15ull) ^ (row >> 3));
+                };
+
+                std::vector<int_t> data(Column::chunkRows);
+                for (std::size_t c = 0; c < 16; ++c) {
+                    for (std::size_t r = 0; r < data.size(); ++r) {
+                        data[r] = value(c * data.size() + r);
+                    }
+                    column.add(column.getType()->createPtr(static_cast<const void*>(data.data())), column.getType()->createPtr(static_cast<const void*>(data.data() + data.size())));
+                }
+                AssertThat(provider->getResidentBytes(), IsLessThan(static_cast<std::size_t>(2 * 1024 * 1024)));
+
+                Column::Cursor cursor = column.scan();
+                Column::Span span;
+                std::size_t rows = 0;
+                bool ok = true;
+                while (cursor.next(span)) {
+                    const int_t* values = static_cast<const int_t*>(span.data);
+                    for (std::size_t i = 0; i < span.rowCount; ++i) {
+                        ok = ok && (values[i] == value(span.firstRow + i));
+                    }
+                    rows += span.rowCount;
+                }
+                AssertThat(ok, IsTrue());
+                AssertThat(rows, Equals(16 * Column::chunkRows));
+                AssertThat(provider->getFaultCount(), IsGreaterThan(static_cast<std::size_t>(0)));
+                AssertThat(provider->getResidentBytes(), IsLessThan(static_cast<std::size_t>(2 * 1024 * 1024)));
+
+                int_t single = 0;
+                column.get(3 * Column::chunkRows + 5, &single);
+                AssertThat(single, Equals(value(3 * Column::chunkRows + 5)));
+
+                // touches every segment, which only stays within the budget if they are pinned one at a time
+                std::vector<std::size_t> rowIds;
+                for (std::size_t r = 0; r < 16 * Column::chunkRows; r += 4099) {
+                    rowIds.push_back((r * 7919) % (16 * Column::chunkRows));
+                }
+                std::vector<int_t> out(rowIds.size());
+                column.gather(rowIds, out.data());
+                for (std::size_t i = 0; i < rowIds.size(); ++i) {
+                    AssertThat(out[i], Equals(value(rowIds[i])));
+                }
+                AssertThat(provider->getResidentBytes(), IsLessThan(static_cast<std::size_t>(2 * 1024 * 1024)));
+            });
+        });
+
+        describe("SynchronizedProvider", [](){
+            it("serves concurrent threads", [](){
+                SynchronizedProvider provider(std::make_shared<InmemoryProvider>());
+                std::vector<std::vector<Segment>> kept(4);
+                std::vector<std::thread> threads;
+
+                for (std::size_t t = 0; t < kept.size(); ++t) {
+                    threads.emplace_back([&provider, &kept, t]() {
+                        for (std::size_t i = 0; i < 2000; ++i) {
+                            Segment s = provider.createSegment(64 + i % 100);
+                            memset(s.ptr(), static_cast<int>(t + 1), s.size());
+                            if (i % 2 == 0) {
+                                provider.freeSegment(s.id());
+                            } else {
+                                kept[t].push_back(s);
+                            }
+                        }
+                    });
+                }
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+
+                std::set<std::size_t> ids;
+                for (std::size_t t = 0; t < kept.size(); ++t) {
+                    for (Segment& k : kept[t]) {
+                        Segment s = provider.getSegment(k.id());
+                        AssertThat(s.ptr(), Equals(k.ptr()));
+                        AssertThat(static_cast<int>(static_cast<char*>(s.ptr())[s.size() - 1]), Equals(static_cast<int>(t + 1)));
+                        ids.insert(s.id());
+                    }
+                }
+                AssertThat(ids.size(), Equals(static_cast<std::size_t>(4000)));
+            });
+        });
+
+        describe("ShardedProvider", [](){
+            it("serves concurrent threads", [](){
+                ShardedProvider provider(3);
+                AssertThat(provider.isThreadSafe(), IsTrue());
+                AssertThat(provider.getShardCount(), Equals(static_cast<std::size_t>(3)));
+
+                std::vector<std::vector<Segment>> kept(4);
+                std::vector<std::thread> threads;
+                for (std::size_t t = 0; t < kept.size(); ++t) {
+                    threads.emplace_back([&provider, &kept, t]() {
+                        for (std::size_t i = 0; i < 10000; ++i) {
+                            Segment s = provider.createSegment(64 + i % 100);
+                            memset(s.ptr(), static_cast<int>(t + 1), s.size());
+                            kept[t].push_back(s);
+                        }
+                    });
+                }
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+
+                // every thread frees half of the segments of its neighbour
+                threads.clear();
+                for (std::size_t t = 0; t < kept.size(); ++t) {
+                    threads.emplace_back([&provider, &kept, t]() {
+                        std::vector<Segment>& other = kept[(t + 1) % kept.size()];
+                        for (std::size_t i = 0; i < other.size(); i += 2) {
+                            provider.freeSegment(other[i].id());
+                        }
+                    });
+                }
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+
+                std::set<std::size_t> ids;
+                for (std::size_t t = 0; t < kept.size(); ++t) {
+                    for (std::size_t i = 0; i < kept[t].size(); ++i) {
+                        if (i % 2 == 0) {
+                            AssertThrows(std::runtime_error, provider.getSegment(kept[t][i].id()));
+                        } else {
+                            Segment s = provider.getSegment(kept[t][i].id());
+                            AssertThat(s.ptr(), Equals(kept[t][i].ptr()));
+                            AssertThat(static_cast<int>(static_cast<char*>(s.ptr())[s.size() - 1]), Equals(static_cast<int>(t + 1)));
+                            ids.insert(s.id());
+                        }
+                    }
+                }
+                AssertThat(ids.size(), Equals(static_cast<std::size_t>(20000)));
+            });
+
+            it("rejects stale and unknown ids", [](){
+                ShardedProvider provider(2);
+                Segment a = provider.createSegment(16);
+                provider.freeSegment(a.id());
+
+                Segment b = provider.createSegment(16);
+                AssertThat(b.id() != a.id(), IsTrue());
+                AssertThrows(std::runtime_error, provider.getSegment(a.id()));
+                AssertThrows(std::runtime_error, provider.freeSegment(a.id()));
+                AssertThrows(std::runtime_error, provider.getSegment(0));
+                AssertThrows(std::runtime_error, provider.getSegment(b.id() + (1 << 8)));
+                AssertThrows(std::runtime_error, provider.getSegment(b.id() | (ShardedProvider::maxShards - 1)));
+            });
+        });
+
+        describe("SlabProvider", [](){
+            it("packs small segments into slabs", [](){
+                SlabProvider provider(std::make_shared<InmemoryProvider>());
+                std::vector<Segment> segments;
+                std::set<std::size_t> ids;
+
+                for (std::size_t i = 1; i <= 5000; ++i) {
+                    Segment s = provider.createSegment(i % 300 + 1);
+                    AssertThat(reinterpret_cast<std::uintptr_t>(s.ptr()) % AbstractProvider::segmentAlignment, Equals(static_cast<std::uintptr_t>(0)));
+                    memset(s.ptr(), static_cast<int>(i % 251), s.size());
+                    segments.push_back(s);
+                    ids.insert(s.id());
+                }
+                AssertThat(ids.size(), Equals(segments.size()));
+
+                for (std::size_t i = 1; i <= segments.size(); ++i) {
+                    Segment s = provider.getSegment(segments[i - 1].id());
+                    AssertThat(s.ptr(), Equals(segments[i - 1].ptr()));
+                    AssertThat(s.size(), Equals(i % 300 + 1));
+                    AssertThat(static_cast<int>(static_cast<unsigned char*>(s.ptr())[s.size() - 1]), Equals(static_cast<int>(i % 251)));
+                }
+            });
+
+            it("reuses freed slots", [](){
+                SlabProvider provider(std::make_shared<InmemoryProvider>());
+                Segment a = provider.createSegment(100);
+                Segment b = provider.createSegment(120);
+                provider.freeSegment(a.id());
+
+                Segment c = provider.createSegment(128);
+                AssertThat(c.ptr(), Equals(a.ptr()));
+                AssertThat(c.size(), Equals(static_cast<std::size_t>(128)));
+                AssertThat(provider.getSegment(b.id()).ptr(), Equals(b.ptr()));
+
+                AssertThrows(std::runtime_error, provider.freeSegment(a.id() + 5));
+                provider.freeSegment(c.id());
+                AssertThrows(std::runtime_error, provider.freeSegment(c.id()));
+            });
+
+            it("passes large segments to the inner provider", [](){
+                provider_t inner = std::make_shared<InmemoryProvider>();
+                SlabProvider provider(inner);
+                Segment s = provider.createSegment(SlabProvider::maxSlotSize + 1);
+
+                AssertThat(inner->getSegment(s.id()).ptr(), Equals(s.ptr()));
+                AssertThat(provider.getSegment(s.id()).size(), Equals(SlabProvider::maxSlotSize + 1));
+                provider.freeSegment(s.id());
+            });
+
+            it("serves as storage of an index", [](){
+                Index<std::size_t, 16> index(std::make_shared<SlabProvider>(std::make_shared<InmemoryProvider>()));
+                for (std::size_t i = 0; i < 20000; ++i) {
+                    index.insert((i * 7919) % 20000, i);
+                }
+                for (std::size_t i = 0; i < 20000; i += 2) {
+                    index.erase(i);
+                }
+
+                std::size_t count = 0;
+                for (auto it = index.begin(); it != index.end(); ++it) {
+                    AssertThat(it.key(), Equals(2 * count + 1));
+                    ++count;
+                }
+                AssertThat(count, Equals(static_cast<std::size_t>(10000)));
+            });
+        });
+
+        describe("Segment resizing", [](){
+            TempDir dir;
+            std::vector<std::pair<std::string, provider_t>> providers{
+                {"InmemoryProvider", std::make_shared<InmemoryProvider>()},
+                {"ShardedProvider", std::make_shared<ShardedProvider>(2)},
+                {"SynchronizedProvider", std::make_shared<SynchronizedProvider>(std::make_shared<InmemoryProvider>())},
+                {"SlabProvider", std::make_shared<SlabProvider>(std::make_shared<InmemoryProvider>())},
+                {"BufferPoolProvider", std::make_shared<BufferPoolProvider>(dir.path + "/spill", 64 * 1024)},
+                {"MmapFileProvider", std::make_shared<MmapFileProvider>(dir.path + "/db", 64 * 1024)}
+            };
+
+            for (const auto& p : providers) {
+                std::string name = "keeps id and content (" + p.first + ")";
+                provider_t provider = p.second;
+
+                it(name.c_str(), [provider](){
+                    std::vector<Segment> others;
+                    Segment s = provider->createSegment(100);
+                    std::size_t id = s.id();
+                    for (std::size_t i = 0; i < s.size(); ++i) {
+                        static_cast<unsigned char*>(s.ptr())[i] = static_cast<unsigned char>(i);
+                    }
+
+                    // neighbours force some of the steps to move the segment
+                    for (std::size_t size : {50, 20000, 20000 + 4096, 300, 9000, 64, 100000}) {
+                        others.push_back(provider->createSegment(64));
+                        s = provider->resizeSegment(id, size);
+
+                        AssertThat(s.id(), Equals(id));
+                        AssertThat(s.size(), Equals(size));
+                        AssertThat(reinterpret_cast<std::uintptr_t>(s.ptr()) % AbstractProvider::segmentAlignment, Equals(static_cast<std::uintptr_t>(0)));
+                        for (std::size_t i = 0; i < 50; ++i) {
+                            AssertThat(static_cast<std::size_t>(static_cast<unsigned char*>(s.ptr())[i]), Equals(i));
+                        }
+                        memset(static_cast<char*>(s.ptr()) + 50, 1, size - 50);
+
+                        Segment t = provider->getSegment(id);
+                        AssertThat(t.ptr(), Equals(s.ptr()));
+                        AssertThat(t.size(), Equals(size));
+                    }
+
+                    provider->freeSegment(id);
+                    for (Segment& o : others) {
+                        provider->freeSegment(o.id());
+                    }
+                    AssertThrows(std::runtime_error, provider->resizeSegment(id, 10));
+                });
+            }
+
+            it("grows file segments in place when the space behind them is free", [&](){
+                MmapFileProvider provider(dir.path + "/inplace", 1024 * 1024);
+                Segment s = provider.createSegment(5000);
+                Segment grown = provider.resizeSegment(s.id(), 50000);
+                AssertThat(grown.ptr(), Equals(s.ptr()));
+
+                Segment shrunk = provider.resizeSegment(s.id(), 4000);
+                AssertThat(shrunk.ptr(), Equals(s.ptr()));
+                Segment next = provider.createSegment(8192);
+                AssertThat(static_cast<char*>(next.ptr()), Equals(static_cast<char*>(s.ptr()) + 4096));
+            });
+        });
+
         describe("Index", [](){
             typedef std::pair<std::size_t, std::size_t> payload_t;
             provider_t provider = std::make_shared<InmemoryProvider>();
@@ -117,6 +709,1086 @@ void test_storage() {
                 }
             }
         });
+
+        describe("Index lookups", [](){
+            provider_t provider = std::make_shared<InmemoryProvider>();
+            Index<std::size_t, 4> index(provider);
+            std::map<std::size_t, std::size_t> reference;
+
+            it("handles empty indexes", [&](){
+                AssertThat(index.begin() == index.end(), Equals(true));
+                AssertThat(index.find(1) == index.end(), Equals(true));
+                AssertThat(index.lowerBound(1) == index.end(), Equals(true));
+            });
+
+            it("fills the index", [&](){
+                for (std::size_t i = 0; i < 200; ++i) {
+                    std::size_t k = (i * 37) % 200 * 2;
+                    index.insert(k, k + 1);
+                    reference[k] = k + 1;
+                }
+                for (std::size_t k = 100; k < 200; k += 6) {
+                    index.erase(k);
+                    reference.erase(k);
+                }
+            });
+
+            it("finds existing keys", [&](){
+                for (const auto& r : reference) {
+                    auto it = index.find(r.first);
+                    AssertThat(it == index.end(), Equals(false));
+                    AssertThat(it.key(), Equals(r.first));
+                    AssertThat(it.record(), Equals(r.second));
+                }
+            });
+
+            it("does not find missing keys", [&](){
+                for (std::size_t k = 0; k < 410; ++k) {
+                    if (reference.find(k) == reference.end()) {
+                        AssertThat(index.find(k) == index.end(), Equals(true));
+                    }
+                }
+            });
+
+            it("provides lower bounds", [&](){
+                for (std::size_t k = 0; k < 410; ++k) {
+                    auto it = index.lowerBound(k);
+                    auto good = reference.lower_bound(k);
+                    if (good == reference.end()) {
+                        AssertThat(it == index.end(), Equals(true));
+                    } else {
+                        AssertThat(it.key(), Equals(good->first));
+                        AssertThat((*it).second, Equals(good->second));
+                    }
+                }
+            });
+
+            it("iterates forward", [&](){
+                auto good = reference.cbegin();
+                for (auto it = index.begin(); it != index.end(); ++it) {
+                    AssertThat(it.key(), Equals(good->first));
+                    ++good;
+                }
+                AssertThat(good == reference.cend(), Equals(true));
+            });
+
+            it("iterates backward", [&](){
+                auto good = reference.crbegin();
+                auto it = index.end();
+                while (it != index.begin()) {
+                    --it;
+                    AssertThat(it.key(), Equals(good->first));
+                    ++good;
+                }
+                AssertThat(good == reference.crend(), Equals(true));
+            });
+
+            it("scans ranges", [&](){
+                std::size_t count = 0;
+                for (auto it = index.lowerBound(51); (it != index.end()) && (it.key() < 251); ++it) {
+                    ++count;
+                }
+                AssertThat(count, Equals(static_cast<std::size_t>(std::distance(reference.lower_bound(51), reference.lower_bound(251)))));
+            });
+
+            it("erases all records", [&](){
+                for (const auto& r : reference) {
+                    index.erase(r.first);
+                }
+                AssertThat(index.empty(), Equals(true));
+            });
+        });
+
+        describe("Index bulk loading", [](){
+            provider_t provider = std::make_shared<InmemoryProvider>();
+            std::vector<std::pair<std::size_t, std::size_t>> records;
+            for (std::size_t i = 1; i <= 10000; ++i) {
+                records.push_back(std::make_pair(i * 3, i));
+            }
+
+            for (double fillFactor : {0.5, 0.8, 1.0}) {
+                std::stringstream ss;
+                ss  << "builds a valid tree (fillFactor="
+                    << fillFactor
+                    << ")";
+
+                it(ss.str().c_str(), [&, fillFactor](){
+                    Index<std::size_t, 16> index(provider);
+                    index.bulkLoad(records.cbegin(), records.cend(), fillFactor);
+
+                    AssertThat(index.first().first, Equals(static_cast<std::size_t>(3)));
+                    AssertThat(index.last().first, Equals(static_cast<std::size_t>(30000)));
+
+                    std::size_t count = 0;
+                    for (auto it = index.begin(); it != index.end(); ++it) {
+                        AssertThat(it.key(), Equals(records[count].first));
+                        ++count;
+                    }
+                    AssertThat(count, Equals(records.size()));
+
+                    AssertThat(index.find(3000).record(), Equals(static_cast<std::size_t>(1000)));
+                    AssertThat(index.find(3001) == index.end(), Equals(true));
+                });
+            }
+
+            it("supports modifications after loading", [&](){
+                Index<std::size_t, 4> index(provider);
+                index.bulkLoad(records.cbegin(), records.cend());
+
+                for (std::size_t i = 1; i <= 10000; i += 2) {
+                    index.erase(i * 3);
+                }
+                for (std::size_t i = 1; i <= 10000; i += 3) {
+                    index.insert(i * 3 + 1, i);
+                }
+
+                std::size_t last = 0;
+                std::size_t count = 0;
+                for (auto it = index.begin(); it != index.end(); ++it) {
+                    AssertThat(it.key(), IsGreaterThan(last));
+                    last = it.key();
+                    ++count;
+                }
+                AssertThat(count, Equals(static_cast<std::size_t>(5000 + 3334)));
+            });
+
+            it("rejects non-empty indexes", [&](){
+                Index<std::size_t, 4> index(provider);
+                index.insert(1, 1);
+                AssertThrows(std::runtime_error, index.bulkLoad(records.cbegin(), records.cend()));
+            });
+        });
+
+        describe("Index with swizzling", [](){
+            provider_t provider = std::make_shared<InmemoryProvider>();
+            Index<std::size_t, 4, true> index(provider);
+            std::map<std::size_t, std::size_t> reference;
+
+            it("survives inserts and erases", [&](){
+                for (std::size_t i = 0; i < 1000; ++i) {
+                    std::size_t k = (i * 7919) % 1000;
+                    index.insert(k, i);
+                    reference[k] = i;
+                }
+                for (std::size_t k = 0; k < 1000; k += 3) {
+                    index.erase(k);
+                    reference.erase(k);
+                }
+
+                for (std::size_t k = 0; k < 1000; ++k) {
+                    auto it = index.find(k);
+                    if (reference.find(k) == reference.end()) {
+                        AssertThat(it == index.end(), Equals(true));
+                    } else {
+                        AssertThat(it.record(), Equals(reference[k]));
+                    }
+                }
+            });
+
+            it("can be unswizzled", [&](){
+                index.unswizzle();
+                for (const auto& r : reference) {
+                    AssertThat(index.find(r.first).record(), Equals(r.second));
+                }
+            });
+
+            it("can be loaded by another instance", [&](){
+                Index<std::size_t, 4, true> other(provider, index.getID());
+                std::size_t count = 0;
+                for (auto it = other.begin(); it != other.end(); ++it) {
+                    AssertThat(it.record(), Equals(reference[it.key()]));
+                    ++count;
+                }
+                AssertThat(count, Equals(reference.size()));
+
+                for (std::size_t k = 1; k < 1000; k += 3) {
+                    other.erase(k);
+                    reference.erase(k);
+                }
+                for (const auto& r : reference) {
+                    AssertThat(index.find(r.first).record(), Equals(r.second));
+                }
+            });
+        });
+
+        describe("KeySearch", [](){
+            it("matches std::upper_bound and std::lower_bound for signed keys", [](){
+                std::vector<int_t> keys;
+                for (int_t k = -300; k < 300; k += 3) {
+                    keys.push_back(k);
+                }
+
+                for (std::size_t n = 0; n <= keys.size(); n += 7) {
+                    for (int_t k = -305; k < 305; ++k) {
+                        AssertThat(KeySearch<int_t>::upper(keys.data(), n, k), Equals(static_cast<std::size_t>(std::upper_bound(keys.begin(), keys.begin() + n, k) - keys.begin())));
+                        AssertThat(KeySearch<int_t>::lower(keys.data(), n, k), Equals(static_cast<std::size_t>(std::lower_bound(keys.begin(), keys.begin() + n, k) - keys.begin())));
+                    }
+                }
+            });
+
+            it("matches std::upper_bound and std::lower_bound for unsigned keys", [](){
+                std::vector<std::size_t> keys64;
+                std::vector<char_t> keys32;
+                for (std::size_t i = 0; i < 150; ++i) {
+                    keys64.push_back((static_cast<std::size_t>(1) << 63) - 75 * 4 + i * 4);
+                    keys32.push_back((static_cast<char_t>(1) << 31) - 75 * 4 + i * 4);
+                }
+
+                for (std::size_t n = 0; n <= keys64.size(); n += 5) {
+                    for (std::size_t i = 0; i < 610; ++i) {
+                        std::size_t k64 = (static_cast<std::size_t>(1) << 63) - 305 + i;
+                        char_t k32 = (static_cast<char_t>(1) << 31) - 305 + i;
+                        AssertThat(KeySearch<std::size_t>::upper(keys64.data(), n, k64), Equals(static_cast<std::size_t>(std::upper_bound(keys64.begin(), keys64.begin() + n, k64) - keys64.begin())));
+                        AssertThat(KeySearch<std::size_t>::lower(keys64.data(), n, k64), Equals(static_cast<std::size_t>(std::lower_bound(keys64.begin(), keys64.begin() + n, k64) - keys64.begin())));
+                        AssertThat(KeySearch<char_t>::upper(keys32.data(), n, k32), Equals(static_cast<std::size_t>(std::upper_bound(keys32.begin(), keys32.begin() + n, k32) - keys32.begin())));
+                        AssertThat(KeySearch<char_t>::lower(keys32.data(), n, k32), Equals(static_cast<std::size_t>(std::lower_bound(keys32.begin(), keys32.begin() + n, k32) - keys32.begin())));
+                    }
+                }
+            });
+        });
+
+        describe("SizedIndex", [](){
+            it("fits nodes into the requested size", [](){
+                AssertThat((SizedIndex<std::size_t, 128>::nodeBytes), Equals(static_cast<std::size_t>(128)));
+                AssertThat((SizedIndex<std::size_t, 192>::nodeBytes), Equals(static_cast<std::size_t>(192)));
+                AssertThat((SizedIndex<std::size_t, 4096>::nodeBytes), Equals(static_cast<std::size_t>(4096)));
+                AssertThat((SizedIndex<char_t, 4096, true>::nodeBytes), Equals(static_cast<std::size_t>(4096)));
+                AssertThat((IndexLayout<std::size_t, false>::fanout(4096)), Equals(static_cast<std::size_t>(251)));
+            });
+
+            it("works with odd fanouts", [](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                SizedIndex<int_t, 192> index(provider);
+                std::map<int_t, std::size_t> reference;
+
+                for (std::size_t i = 0; i < 2000; ++i) {
+                    int_t k = static_cast<int_t>((i * 7919) % 2000) - 1000;
+                    index.insert(k, i);
+                    reference[k] = i;
+                }
+                for (int_t k = -1000; k < 1000; k += 3) {
+                    index.erase(k);
+                    reference.erase(k);
+                }
+
+                auto good = reference.cbegin();
+                for (auto it = index.begin(); it != index.end(); ++it) {
+                    AssertThat(it.key(), Equals(good->first));
+                    AssertThat(it.record(), Equals(good->second));
+                    ++good;
+                }
+                AssertThat(good == reference.cend(), Equals(true));
+            });
+
+            it("stores page sized nodes in files", [](){
+                TempDir dir;
+                std::string path = dir.path + "/db";
+                std::vector<std::pair<std::size_t, std::size_t>> records;
+                for (std::size_t i = 0; i < 100000; ++i) {
+                    records.push_back(std::make_pair(i, i + 1));
+                }
+
+                provider_t provider = std::make_shared<MmapFileProvider>(path);
+                SizedIndex<std::size_t, 4096> index(provider);
+                index.bulkLoad(records.cbegin(), records.cend());
+                AssertThat(index.find(54321).record(), Equals(static_cast<std::size_t>(54322)));
+            });
+        });
+
+        describe("Index appends", [](){
+            // returns the fill levels of all leaves in key order
+            auto leafFills = [](Index<std::size_t, 4>& index) {
+                std::ostringstream os;
+                index.dump(os);
+                std::string dump = os.str();
+                std::vector<std::size_t> fills;
+
+                std::size_t pos = 0;
+                while ((pos = dump.find("(leaf) filled=", pos)) != std::string::npos) {
+                    pos += strlen("(leaf) filled=");
+                    fills.push_back(std::strtoul(dump.c_str() + pos, nullptr, 10));
+                }
+                return fills;
+            };
+
+            it("packs leaves completely", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Index<std::size_t, 4> index(provider);
+
+                for (std::size_t i = 1; i <= 1001; ++i) {
+                    index.insert(i, i * 2);
+                    AssertThat(index.last().first, Equals(i));
+                }
+
+                std::vector<std::size_t> fills = leafFills(index);
+                AssertThat(fills.size(), Equals(static_cast<std::size_t>(251)));
+                for (std::size_t i = 0; i + 1 < fills.size(); ++i) {
+                    AssertThat(fills[i], Equals(static_cast<std::size_t>(4)));
+                }
+
+                std::size_t expected = 1;
+                for (auto it = index.begin(); it != index.end(); ++it, ++expected) {
+                    AssertThat(it.key(), Equals(expected));
+                    AssertThat(it.record(), Equals(expected * 2));
+                }
+                AssertThat(expected, Equals(static_cast<std::size_t>(1002)));
+                for (std::size_t i = 1; i <= 1001; ++i) {
+                    AssertThat(index.find(i).record(), Equals(i * 2));
+                }
+            });
+
+            it("notices appends of another instance on the same root", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Index<std::size_t, 4> index(provider);
+                Index<std::size_t, 4> other(provider, index.getID());
+
+                for (std::size_t i = 1; i <= 300; ++i) {
+                    Index<std::size_t, 4>& target = ((i / 10) % 2 == 0) ? index : other;
+                    target.insert(i, i * 2);
+                }
+
+                std::size_t expected = 1;
+                for (auto it = index.begin(); it != index.end(); ++it, ++expected) {
+                    AssertThat(it.key(), Equals(expected));
+                    AssertThat(it.record(), Equals(expected * 2));
+                }
+                AssertThat(expected, Equals(static_cast<std::size_t>(301)));
+                AssertThat(other.last().first, Equals(static_cast<std::size_t>(300)));
+            });
+
+            it("notices leaves freed by another instance on the same root", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Index<std::size_t, 4> index(provider);
+                for (std::size_t i = 1; i <= 40; ++i) {
+                    index.insert(i, i * 2);
+                }
+
+                // merges free the cached right-most leaf, new nodes may reuse its id
+                Index<std::size_t, 4> other(provider, index.getID());
+                for (std::size_t i = 40; i > 20; --i) {
+                    other.erase(i);
+                }
+                for (std::size_t i = 1; i <= 20; i += 2) {
+                    other.erase(i);
+                    other.insert(i, i * 2);
+                }
+
+                for (std::size_t i = 21; i <= 60; ++i) {
+                    index.insert(i, i * 2);
+                }
+
+                std::size_t expected = 1;
+                for (auto it = other.begin(); it != other.end(); ++it, ++expected) {
+                    AssertThat(it.key(), Equals(expected));
+                    AssertThat(it.record(), Equals(expected * 2));
+                }
+                AssertThat(expected, Equals(static_cast<std::size_t>(61)));
+            });
+
+            it("mixes appends with inserts and erases", [](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Index<std::size_t, 3, true> index(provider);
+                std::map<std::size_t, std::size_t> reference;
+
+                for (std::size_t round = 0; round < 50; ++round) {
+                    for (std::size_t i = 0; i < 20; ++i) {
+                        std::size_t k = (round + 1) * 1000 + i * 10;
+                        index.insert(k, k + 1);
+                        reference[k] = k + 1;
+                    }
+
+                    // fill gaps and delete a few, which splits and merges the right-most leaf as well
+                    for (std::size_t i = 0; i < 5; ++i) {
+                        std::size_t k = (round + 1) * 1000 + 95 + i * 10;
+                        index.insert(k, k + 1);
+                        reference[k] = k + 1;
+                    }
+                    for (std::size_t i = 0; i < 3; ++i) {
+                        std::size_t k = (round + 1) * 1000 + 190 - i * 10;
+                        index.erase(k);
+                        reference.erase(k);
+                    }
+
+                    AssertThat(index.last().first, Equals(reference.rbegin()->first));
+                }
+
+                auto good = reference.cbegin();
+                for (auto it = index.begin(); it != index.end(); ++it, ++good) {
+                    AssertThat(it.key(), Equals(good->first));
+                    AssertThat(it.record(), Equals(good->second));
+                }
+                AssertThat(good == reference.cend(), Equals(true));
+            });
+
+            it("inserts sorted batches", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Index<std::size_t, 4> index(provider);
+                std::map<std::size_t, std::size_t> reference;
+
+                std::vector<std::pair<std::size_t, std::size_t>> batch;
+                for (std::size_t i = 0; i < 100; ++i) {
+                    batch.push_back(std::make_pair(i * 10, i));
+                }
+                index.insertSorted(batch.cbegin(), batch.cend());
+                reference.insert(batch.cbegin(), batch.cend());
+
+                // starts inside the existing key range and continues behind it
+                batch.clear();
+                for (std::size_t i = 0; i < 500; ++i) {
+                    batch.push_back(std::make_pair(905 + i * 10, i));
+                }
+                index.insertSorted(batch.cbegin(), batch.cend());
+                reference.insert(batch.cbegin(), batch.cend());
+
+                std::vector<std::size_t> fills = leafFills(index);
+                AssertThat(fills.back(), IsGreaterThan(static_cast<std::size_t>(0)));
+                AssertThat(fills[fills.size() - 2], Equals(static_cast<std::size_t>(4)));
+
+                auto good = reference.cbegin();
+                for (auto it = index.begin(); it != index.end(); ++it, ++good) {
+                    AssertThat(it.key(), Equals(good->first));
+                    AssertThat(it.record(), Equals(good->second));
+                }
+                AssertThat(good == reference.cend(), Equals(true));
+            });
+        });
+
+        describe("ConcurrentIndex", [](){
+            it("behaves like a map on a single thread", [](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                ConcurrentIndex<int_t, 4> index(provider);
+                std::map<int_t, std::size_t> reference;
+
+                for (std::size_t i = 0; i < 3000; ++i) {
+                    int_t k = static_cast<int_t>((i * 7919) % 1500) - 750;
+                    AssertThat(index.insert(k, i), Equals(reference.find(k) == reference.end()));
+                    reference[k] = i;
+                }
+
+                for (const auto& kv : reference) {
+                    std::size_t record = 0;
+                    AssertThat(index.lookup(kv.first, record), IsTrue());
+                    AssertThat(record, Equals(kv.second));
+                }
+                std::size_t record = 0;
+                AssertThat(index.lookup(1000, record), IsFalse());
+
+                std::vector<std::pair<int_t, std::size_t>> out(reference.size() + 1);
+                AssertThat(index.scan(-750, out.size(), out.data()), Equals(reference.size()));
+                auto good = reference.cbegin();
+                for (std::size_t i = 0; i < reference.size(); ++i, ++good) {
+                    AssertThat(out[i].first, Equals(good->first));
+                    AssertThat(out[i].second, Equals(good->second));
+                }
+                AssertThat(index.scan(748, 10, out.data()), Equals(static_cast<std::size_t>(2)));
+            });
+
+            it("survives concurrent inserts and lookups", [](){
+                const std::size_t nThreads = 8;
+                const std::size_t perThread = 20000;
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                ConcurrentIndex<std::size_t, 8> index(provider);
+                std::atomic<std::size_t> misses(0);
+                std::vector<std::thread> threads;
+
+                for (std::size_t t = 0; t < nThreads; ++t) {
+                    threads.emplace_back([&index, &misses, t, nThreads, perThread](){
+                        for (std::size_t i = 0; i < perThread; ++i) {
+                            std::size_t k = i * nThreads + t;
+                            index.insert(k, k + 1);
+
+                            // own keys have to be visible immediately, other keys must carry the right record
+                            std::size_t record = 0;
+                            if (!index.lookup(k, record) || (record != k + 1)) {
+                                ++misses;
+                            }
+                            std::size_t other = (k * 31) % (nThreads * perThread);
+                            if (index.lookup(other, record) && (record != other + 1)) {
+                                ++misses;
+                            }
+                        }
+                    });
+                }
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+
+                AssertThat(misses.load(), Equals(static_cast<std::size_t>(0)));
+                for (std::size_t k = 0; k < nThreads * perThread; ++k) {
+                    std::size_t record = 0;
+                    AssertThat(index.lookup(k, record), IsTrue());
+                    AssertThat(record, Equals(k + 1));
+                }
+
+                std::vector<std::pair<std::size_t, std::size_t>> out(nThreads * perThread);
+                AssertThat(index.scan(0, out.size(), out.data()), Equals(out.size()));
+                for (std::size_t k = 0; k < out.size(); ++k) {
+                    AssertThat(out[k].first, Equals(k));
+                }
+            });
+        });
+
+        describe("Column", [](){
+            // adds the values [begin, end) as one segment
+            auto addRange = [](Column& column, int_t begin, int_t end) {
+                std::vector<int_t> data;
+                for (int_t v = begin; v < end; ++v) {
+                    data.push_back(v);
+                }
+                auto t = column.getType();
+                column.add(t->createPtr(static_cast<const void*>(data.data())), t->createPtr(static_cast<const void*>(data.data() + data.size())));
+            };
+
+            it("scans spans in row order", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Column column(std::make_shared<Int>(), provider);
+                addRange(column, 0, 10);
+                column.flush();
+                addRange(column, 10, 10);
+                addRange(column, 10, 35);
+                column.flush();
+                addRange(column, 35, 36);
+                AssertThat(column.size(), Equals(static_cast<std::size_t>(36)));
+
+                Column::Cursor cursor = column.scan();
+                Column::Span span;
+                std::vector<std::size_t> counts;
+                std::size_t expected = 0;
+                while (cursor.next(span)) {
+                    AssertThat(span.firstRow, Equals(expected));
+                    const int_t* values = static_cast<const int_t*>(span.data);
+                    for (std::size_t i = 0; i < span.rowCount; ++i) {
+                        AssertThat(values[i], Equals(static_cast<int_t>(expected + i)));
+                    }
+                    expected += span.rowCount;
+                    counts.push_back(span.rowCount);
+                }
+                AssertThat(expected, Equals(static_cast<std::size_t>(36)));
+                AssertThat(counts, Equals(std::vector<std::size_t>{10, 25, 1}));
+            });
+
+            it("starts scans in the middle of segments", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Column column(std::make_shared<Int>(), provider);
+                for (int_t i = 0; i < 100; ++i) {
+                    addRange(column, i * 7, (i + 1) * 7);
+                    column.flush();
+                }
+
+                for (std::size_t from : {0, 1, 6, 7, 8, 350, 699}) {
+                    ColumnView<int_t> view(std::make_shared<Column>(std::make_shared<Int>(), provider, column.getID()));
+                    ColumnView<int_t>::Cursor cursor = view.scan(from);
+                    ColumnView<int_t>::Span span;
+                    std::size_t expected = from;
+
+                    while (cursor.next(span)) {
+                        AssertThat(span.firstRow, Equals(expected));
+                        for (std::size_t i = 0; i < span.rowCount; ++i) {
+                            AssertThat(span.data[i], Equals(static_cast<int_t>(expected + i)));
+                        }
+                        expected += span.rowCount;
+                    }
+                    AssertThat(expected, Equals(static_cast<std::size_t>(700)));
+                }
+
+                Column::Span span;
+                AssertThat(column.scan(700).next(span), IsFalse());
+                AssertThat(Column(std::make_shared<Int>(), provider).scan().next(span), IsFalse());
+            });
+
+            it("coalesces small appends into chunks", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                std::size_t id;
+                {
+                    Column column(std::make_shared<Int>(), provider);
+                    for (int_t i = 0; i < 20000; ++i) {
+                        addRange(column, i * 10, (i + 1) * 10);
+                    }
+                    AssertThat(column.size(), Equals(static_cast<std::size_t>(200000)));
+                    int_t value = 0;
+                    column.get(199999, &value);
+                    AssertThat(value, Equals(static_cast<int_t>(199999)));
+
+                    // sealed chunks get decoded in blocks, the tail is a single span
+                    std::size_t expected = 1;
+                    Column::Cursor cursor = column.scan(1);
+                    Column::Span span;
+                    while (cursor.next(span)) {
+                        AssertThat(span.firstRow, Equals(expected));
+                        AssertThat(span.firstRow / Column::chunkRows, Equals((span.firstRow + span.rowCount - 1) / Column::chunkRows));
+                        if (span.firstRow < 3 * Column::chunkRows) {
+                            AssertThat(span.rowCount, Equals(std::min(Column::blockRows, Column::chunkRows - span.firstRow % Column::chunkRows)));
+                        } else {
+                            AssertThat(span.rowCount, Equals(200000 - 3 * Column::chunkRows));
+                        }
+                        AssertThat(*static_cast<const int_t*>(span.data), Equals(static_cast<int_t>(span.firstRow)));
+                        expected += span.rowCount;
+                    }
+                    AssertThat(expected, Equals(static_cast<std::size_t>(200000)));
+
+                    id = column.getID();
+                }
+
+                // the destructor flushed the tail
+                column_t column = std::make_shared<Column>(std::make_shared<Int>(), provider, id);
+                ColumnView<int_t> view(column);
+                AssertThat(view.size(), Equals(static_cast<std::size_t>(200000)));
+                std::vector<std::size_t> rowIds{199999, 0, 65535, 65536, 131072, 196608};
+                std::vector<int_t> out(rowIds.size());
+                view.gather(rowIds, out.data());
+                for (std::size_t i = 0; i < rowIds.size(); ++i) {
+                    AssertThat(out[i], Equals(static_cast<int_t>(rowIds[i])));
+                }
+
+                addRange(*column, 200000, 200005);
+                AssertThat(view.get(200004), Equals(static_cast<int_t>(200004)));
+            });
+
+            it("adopts chunks without copying", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Column column(std::make_shared<Int>(), provider);
+                addRange(column, 0, 5);
+
+                Column::Chunk chunk = column.allocateChunk(100);
+                int_t* values = static_cast<int_t*>(chunk.data);
+                for (std::size_t i = 0; i < chunk.rows; ++i) {
+                    values[i] = static_cast<int_t>(5 + i);
+                }
+                column.adoptChunk(chunk);
+                column.discardChunk(column.allocateChunk(10));
+                addRange(column, 105, 110);
+                AssertThat(column.size(), Equals(static_cast<std::size_t>(110)));
+
+                Column::Cursor cursor = column.scan();
+                Column::Span span;
+                std::vector<const void*> spans;
+                while (cursor.next(span)) {
+                    spans.push_back(span.data);
+                    for (std::size_t i = 0; i < span.rowCount; ++i) {
+                        AssertThat(static_cast<const int_t*>(span.data)[i], Equals(static_cast<int_t>(span.firstRow + i)));
+                    }
+                }
+                AssertThat(spans.size(), Equals(static_cast<std::size_t>(3)));
+                AssertThat(spans[1] == chunk.data, IsTrue());
+                int_t value = 0;
+                column.get(104, &value);
+                AssertThat(value, Equals(static_cast<int_t>(104)));
+            });
+
+            it("accesses single rows", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                column_t column = std::make_shared<Column>(std::make_shared<Int>(), provider);
+                for (int_t i = 0; i < 50; ++i) {
+                    addRange(*column, i * i, (i + 1) * (i + 1));
+                }
+                ColumnView<int_t> view(column);
+
+                for (std::size_t row = 0; row < 2500; ++row) {
+                    AssertThat(view.get(row), Equals(static_cast<int_t>(row)));
+                }
+                AssertThrows(std::runtime_error, view.get(2500));
+            });
+
+            it("gathers rows", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                column_t column = std::make_shared<Column>(std::make_shared<Int>(), provider);
+                for (int_t i = 0; i < 100; ++i) {
+                    addRange(*column, i * 13, (i + 1) * 13);
+                }
+                ColumnView<int_t> view(column);
+
+                std::vector<std::size_t> rowIds;
+                for (std::size_t i = 0; i < 3000; ++i) {
+                    rowIds.push_back((i * 7919) % 1300);
+                }
+                rowIds.push_back(rowIds.front());
+
+                std::vector<int_t> out(rowIds.size());
+                view.gather(rowIds, out.data());
+                for (std::size_t i = 0; i < rowIds.size(); ++i) {
+                    AssertThat(out[i], Equals(static_cast<int_t>(rowIds[i])));
+                }
+
+                std::sort(rowIds.begin(), rowIds.end());
+                view.gather(rowIds, out.data());
+                for (std::size_t i = 0; i < rowIds.size(); ++i) {
+                    AssertThat(out[i], Equals(static_cast<int_t>(rowIds[i])));
+                }
+
+                rowIds.push_back(1300);
+                AssertThrows(std::runtime_error, view.gather(rowIds, out.data()));
+            });
+
+            it("accesses single rows of values wider than eight bytes", [&](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                typeptr_t pair = std::make_shared<Tuple>(std::vector<typeptr_t>{std::make_shared<Int>(), std::make_shared<Int>()});
+                Column column(pair, provider);
+
+                std::size_t nRows = Column::chunkRows + 10;
+                std::vector<int_t> data;
+                for (std::size_t r = 0; r < nRows; ++r) {
+                    data.push_back(static_cast<int_t>(r));
+                    data.push_back(-static_cast<int_t>(r));
+                }
+                column.add(pair->createPtr(static_cast<const void*>(data.data())), pair->createPtr(static_cast<const void*>(data.data() + data.size())));
+
+                for (std::size_t r : std::vector<std::size_t>{0, 17, Column::chunkRows - 1, Column::chunkRows + 9}) {
+                    int_t value[2] = {0, 0};
+                    column.get(r, value);
+                    AssertThat(value[0], Equals(static_cast<int_t>(r)));
+                    AssertThat(value[1], Equals(-static_cast<int_t>(r)));
+                }
+
+                std::vector<std::size_t> rowIds{Column::chunkRows + 3, 5, Column::chunkRows - 2};
+                std::vector<int_t> out(2 * rowIds.size());
+                column.gather(rowIds, out.data());
+                for (std::size_t i = 0; i < rowIds.size(); ++i) {
+                    AssertThat(out[2 * i], Equals(static_cast<int_t>(rowIds[i])));
+                    AssertThat(out[2 * i + 1], Equals(-static_cast<int_t>(rowIds[i])));
+                }
+            });
+
+            it("keeps zone maps of sealed segments", [&](){
+                TempDir dir;
+                std::string path = dir.path + "/db";
+                std::size_t id = 0;
+                {
+                    provider_t provider = std::make_shared<MmapFileProvider>(path, 64 * 1024);
+                    Column column(std::make_shared<Int>(), provider);
+                    addRange(column, 1000, 1000 + static_cast<int_t>(Column::chunkRows) + 10);
+
+                    Column::Chunk chunk = column.allocateChunk(3);
+                    int_t* values = static_cast<int_t*>(chunk.data);
+                    values[0] = 7;
+                    values[1] = -4;
+                    values[2] = 9;
+                    column.adoptChunk(chunk);
+                    addRange(column, 0, 5);
+
+                    std::vector<Column::Zone> zones = column.zones();
+                    AssertThat(zones.size(), Equals(static_cast<std::size_t>(4)));
+                    AssertThat(zones[3].hasRange, IsFalse());
+                    AssertThat(zones[3].firstRow, Equals(Column::chunkRows + 13));
+
+                    column.flush();
+                    id = column.getID();
+                }
+
+                provider_t provider = std::make_shared<MmapFileProvider>(path);
+                Column column(std::make_shared<Int>(), provider, id);
+                std::vector<Column::Zone> zones = column.zones();
+                AssertThat(zones.size(), Equals(static_cast<std::size_t>(4)));
+
+                std::vector<std::pair<int_t, int_t>> expected{{1000, 1000 + static_cast<int_t>(Column::chunkRows) - 1}, {1000 + static_cast<int_t>(Column::chunkRows), 1000 + static_cast<int_t>(Column::chunkRows) + 9}, {-4, 9}, {0, 4}};
+                std::size_t firstRow = 0;
+                for (std::size_t i = 0; i < zones.size(); ++i) {
+                    int_t min = 0;
+                    int_t max = 0;
+                    memcpy(&min, zones[i].min, sizeof(int_t));
+                    memcpy(&max, zones[i].max, sizeof(int_t));
+
+                    AssertThat(zones[i].firstRow, Equals(firstRow));
+                    AssertThat(zones[i].hasRange, IsTrue());
+                    AssertThat(min, Equals(expected[i].first));
+                    AssertThat(max, Equals(expected[i].second));
+                    firstRow += zones[i].rowCount;
+                }
+                AssertThat(firstRow, Equals(column.size()));
+            });
+
+            it("checks the type of views", [](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                column_t column = std::make_shared<Column>(std::make_shared<Int>(), provider);
+
+                AssertThrows(std::runtime_error, (ColumnView<char>(column)));
+            });
+        });
+
+        describe("Table", [](){
+            it("transposes rows into columns", [](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                typeptr_t triple = std::make_shared<Tuple>(std::vector<typeptr_t>{std::make_shared<Byte>(), std::make_shared<Bool>(), std::make_shared<Byte>()});
+                Table table({std::make_shared<Int>(), std::make_shared<Byte>(), triple, std::make_shared<Float>()}, provider);
+                typeptr_t rowType = table.getRowType();
+                AssertThat(rowType->getSize(), Equals(static_cast<std::size_t>(20)));
+
+                // more rows than one transpose block and than one chunk, so fields of every width take both paths
+                std::size_t nRows = Column::chunkRows + 3 * transposeBlockBytes / rowType->getSize() + 7;
+                std::vector<char> rows(nRows * rowType->getSize());
+                for (std::size_t r = 0; r < nRows; ++r) {
+                    char* row = rows.data() + r * rowType->getSize();
+                    int_t i = static_cast<int_t>(r) * 3;
+                    byte_t b = static_cast<byte_t>(r % 256);
+                    char t[3] = {static_cast<char>(r % 7), static_cast<char>(r % 2), static_cast<char>(r % 11)};
+                    double f = static_cast<double>(r) / 4;
+                    memcpy(row, &i, 8);
+                    memcpy(row + 8, &b, 1);
+                    memcpy(row + 9, t, 3);
+                    memcpy(row + 12, &f, 8);
+                }
+                table.addRows(rowType->createPtr(static_cast<const void*>(rows.data())), rowType->createPtr(static_cast<const void*>(rows.data() + rows.size())));
+                table.addRows(rowType->createPtr(static_cast<const void*>(rows.data())), rowType->createPtr(static_cast<const void*>(rows.data() + 10 * rowType->getSize())));
+
+                for (std::size_t c = 0; c < table.getColumnCount(); ++c) {
+                    AssertThat(table.getColumn(c)->size(), Equals(nRows + 10));
+                }
+                for (std::size_t r = 0; r < nRows + 10; ++r) {
+                    std::size_t source = (r < nRows) ? r : r - nRows;
+                    char expected[20];
+                    memcpy(expected, rows.data() + source * rowType->getSize(), 20);
+
+                    char actual[20];
+                    table.getColumn(0)->get(r, actual);
+                    table.getColumn(1)->get(r, actual + 8);
+                    table.getColumn(2)->get(r, actual + 9);
+                    table.getColumn(3)->get(r, actual + 12);
+                    AssertThat(memcmp(actual, expected, 20), Equals(0));
+                }
+
+                int_t value = 0;
+                dataptrconst_t intPtr = std::make_shared<Int>()->createPtr(static_cast<const void*>(&value));
+                AssertThrows(std::runtime_error, table.addRows(intPtr, intPtr));
+            });
+
+            it("keeps row batches in segments of chunkRows rows", [](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Table table({std::make_shared<Int>(), std::make_shared<Byte>()}, provider);
+                typeptr_t rowType = table.getRowType();
+                std::size_t rowSize = rowType->getSize();
+
+                std::size_t nRows = 3 * Column::chunkRows + 100;
+                std::vector<char> rows(nRows * rowSize);
+                for (std::size_t r = 0; r < nRows; ++r) {
+                    int_t i = static_cast<int_t>(r);
+                    byte_t b = static_cast<byte_t>(r % 3);
+                    memcpy(rows.data() + r * rowSize, &i, 8);
+                    memcpy(rows.data() + r * rowSize + 8, &b, 1);
+                }
+                auto addRows = [&](std::size_t from, std::size_t to) {
+                    table.addRows(rowType->createPtr(static_cast<const void*>(rows.data() + from * rowSize)), rowType->createPtr(static_cast<const void*>(rows.data() + to * rowSize)));
+                };
+
+                // small batches collect in the tail
+                for (std::size_t r = 0; r < 10000; r += 10) {
+                    addRows(r, r + 10);
+                }
+                AssertThat(table.getColumn(0)->zones().size(), Equals(static_cast<std::size_t>(1)));
+
+                // a large batch completes the tail first, full chunks get encoded
+                addRows(10000, nRows);
+                for (std::size_t c = 0; c < table.getColumnCount(); ++c) {
+                    std::vector<Column::Zone> zones = table.getColumn(c)->zones();
+                    AssertThat(zones.size(), Equals(static_cast<std::size_t>(4)));
+                    for (std::size_t z = 0; z < 3; ++z) {
+                        AssertThat(zones[z].firstRow, Equals(z * Column::chunkRows));
+                        AssertThat(zones[z].rowCount, Equals(Column::chunkRows));
+                    }
+                    AssertThat(table.getColumn(c)->getTailRows(), Equals(static_cast<std::size_t>(100)));
+                }
+
+                ColumnView<int_t> ints(table.getColumn(0));
+                ColumnView<byte_t> bytes(table.getColumn(1));
+                for (std::size_t r = 0; r < nRows; r += 997) {
+                    AssertThat(ints.get(r), Equals(static_cast<int_t>(r)));
+                    AssertThat(bytes.get(r), Equals(static_cast<byte_t>(r % 3)));
+                }
+            });
+
+            it("ingests column ranges in parallel", [](){
+                ThreadPool pool(4);
+                std::vector<provider_t> providers{std::make_shared<InmemoryProvider>(), std::make_shared<SynchronizedProvider>(std::make_shared<InmemoryProvider>()), std::make_shared<ShardedProvider>()};
+                AssertThat(providers[0]->isThreadSafe(), IsFalse());
+                AssertThat(providers[1]->isThreadSafe(), IsTrue());
+                AssertThat(providers[2]->isThreadSafe(), IsTrue());
+
+                for (const auto& provider : providers) {
+                    std::list<typeptr_t> types(16, std::make_shared<Int>());
+                    Table table(types, provider);
+
+                    std::vector<std::vector<int_t>> data(types.size());
+                    for (std::size_t batch = 0; batch < 3; ++batch) {
+                        std::list<std::pair<dataptrconst_t, dataptrconst_t>> ranges;
+                        for (std::size_t c = 0; c < types.size(); ++c) {
+                            data[c].assign(70000, 0);
+                            for (std::size_t r = 0; r < data[c].size(); ++r) {
+                                data[c][r] = static_cast<int_t>(batch * 1000000 + c * 100000 + r);
+                            }
+                            auto t = table.getColumn(c)->getType();
+                            ranges.push_back(std::make_pair(t->createPtr(static_cast<const void*>(data[c].data())), t->createPtr(static_cast<const void*>(data[c].data() + data[c].size()))));
+                        }
+                        table.addColumnRanges(ranges, pool);
+                    }
+
+                    for (std::size_t c = 0; c < types.size(); ++c) {
+                        column_t column = table.getColumn(c);
+                        AssertThat(column->size(), Equals(static_cast<std::size_t>(210000)));
+                        for (std::size_t r = 0; r < column->size(); r += 997) {
+                            int_t value = 0;
+                            column->get(r, &value);
+                            AssertThat(value, Equals(static_cast<int_t>((r / 70000) * 1000000 + c * 100000 + r % 70000)));
+                        }
+                    }
+
+                    AssertThrows(std::runtime_error, table.addColumnRanges({}, pool));
+                }
+            });
+
+            it("scans aligned batches", [](){
+                provider_t provider = std::make_shared<InmemoryProvider>();
+                Table table({std::make_shared<Int>(), std::make_shared<Byte>(), std::make_shared<Int>()}, provider);
+                std::size_t nRows = 3 * Column::chunkRows + 1234;
+
+                // every column gets its own segment boundaries and encodings
+                std::vector<std::size_t> batches{777, 5000, 30011};
+                for (std::size_t c = 0; c < 3; ++c) {
+                    column_t column = table.getColumn(c);
+                    std::size_t elementSize = column->getType()->getSize();
+                    std::vector<char> values(nRows * elementSize);
+                    for (std::size_t r = 0; r < nRows; ++r) {
+                        int_t v = (c == 0) ? static_cast<int_t>(r) : (c == 1) ? static_cast<int_t>(r % 200) : static_cast<int_t>((r * 2654435761u) % 1000003);
+                        memcpy(values.data() + r * elementSize, &v, elementSize);
+                    }
+                    for (std::size_t r = 0; r < nRows; r += batches[c]) {
+                        std::size_t n = std::min(batches[c], nRows - r);
+                        column->add(column->getType()->createPtr(static_cast<const void*>(values.data() + r * elementSize)), column->getType()->createPtr(static_cast<const void*>(values.data() + (r + n) * elementSize)));
+                        if (c == 1) {
+                            column->flush();
+                        }
+                    }
+                }
+                table.getColumn(2)->flush();
+
+                Table::Cursor cursor = table.scan({2, 0, 1}, 1000);
+                Table::Batch batch;
+                std::size_t expectedRow = 0;
+                while (cursor.next(batch)) {
+                    AssertThat(batch.firstRow, Equals(expectedRow));
+                    AssertThat(batch.rowCount, Equals(std::min<std::size_t>(1000, nRows - expectedRow)));
+                    AssertThat(batch.data.size(), Equals(static_cast<std::size_t>(3)));
+
+                    const int_t* c2 = static_cast<const int_t*>(batch.data[0]);
+                    const int_t* c0 = static_cast<const int_t*>(batch.data[1]);
+                    const byte_t* c1 = static_cast<const byte_t*>(batch.data[2]);
+                    for (std::size_t i = 0; i < batch.rowCount; ++i) {
+                        std::size_t r = batch.firstRow + i;
+                        AssertThat(c0[i], Equals(static_cast<int_t>(r)));
+                        AssertThat(c1[i], Equals(static_cast<byte_t>(r % 200)));
+                        AssertThat(c2[i], Equals(static_cast<int_t>((r * 2654435761u) % 1000003)));
+                    }
+                    expectedRow += batch.rowCount;
+                }
+                AssertThat(expectedRow, Equals(nRows));
+
+                AssertThrows(std::runtime_error, table.scan({}));
+                int_t extra = 1;
+                table.getColumn(0)->add(std::make_shared<Int>()->createPtr(static_cast<const void*>(&extra)), std::make_shared<Int>()->createPtr(static_cast<const void*>(&extra + 1)));
+                AssertThrows(std::runtime_error, table.scan({0, 1}));
+            });
+        });
+
+        describe("Encoding", [](){
+            // encodes values narrowed to <elementSize> bytes, checks full and partial decoding, returns the plan
+            auto roundtrip = [](const std::vector<std::int64_t>& values, std::size_t elementSize) {
+                std::vector<char> raw(values.size() * elementSize);
+                for (std::size_t i = 0; i < values.size(); ++i) {
+                    memcpy(raw.data() + i * elementSize, &values[i], elementSize); // little endian narrowing
+                }
+
+                EncodingPlan plan = planEncoding(raw.data(), values.size(), elementSize);
+                std::vector<std::uint64_t> segment(plan.bytes / 8 + 1);
+                encodeSegment(plan, raw.data(), segment.data());
+                const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(segment.data());
+                AssertThat(header->rows, Equals(values.size()));
+
+                std::vector<char> out(raw.size());
+                decodeSegment(header, 0, values.size(), out.data());
+                AssertThat(memcmp(out.data(), raw.data(), raw.size()), Equals(0));
+
+                for (std::size_t first : {1, 127, 128, 129, 1000}) {
+                    std::size_t count = std::min(static_cast<std::size_t>(300), values.size() - first);
+                    decodeSegment(header, first, count, out.data());
+                    AssertThat(memcmp(out.data(), raw.data() + first * elementSize, count * elementSize), Equals(0));
+                }
+
+                return plan;
+            };
+
+            std::vector<std::size_t> widths{1, 2, 4, 8};
+
+            it("packs small ranges with frame-of-reference", [&](){
+                std::vector<std::int64_t> values;
+                for (std::size_t i = 0; i < 5000; ++i) {
+                    values.push_back(static_cast<std::int64_t>((i * 7919) % 13) - 100);
+                }
+
+                for (std::size_t w : widths) {
+                    EncodingPlan plan = roundtrip(values, w);
+                    AssertThat(plan.header.encoding == Encoding::FrameOfReference, IsTrue());
+                    AssertThat(plan.header.bitWidth, Equals(static_cast<std::uint8_t>(4)));
+                }
+            });
+
+            it("uses deltas for sorted data", [&](){
+                std::vector<std::int64_t> values;
+                for (std::size_t i = 0; i < 5000; ++i) {
+                    values.push_back(static_cast<std::int64_t>(1400000000000 + i * 1000 + (i % 3)));
+                }
+
+                EncodingPlan plan = roundtrip(values, 8);
+                AssertThat(plan.header.encoding == Encoding::Delta, IsTrue());
+                AssertThat(plan.bytes, IsLessThan(values.size() * 8 / 8));
+            });
+
+            it("uses dictionaries for few distinct values", [&](){
+                std::vector<std::int64_t> values;
+                for (std::size_t i = 0; i < 5000; ++i) {
+                    values.push_back(static_cast<std::int64_t>((i * 7919) % 3 - 1) * 1000000007);
+                }
+
+                for (std::size_t w : {4, 8}) {
+                    EncodingPlan plan = roundtrip(values, w);
+                    AssertThat(plan.header.encoding == Encoding::Dictionary, IsTrue());
+                    AssertThat(plan.header.nEntries, Equals(static_cast<std::uint64_t>(3)));
+                }
+            });
+
+            it("uses run-length encoding for long runs", [&](){
+                std::vector<std::int64_t> values;
+                for (std::size_t i = 0; i < 5000; ++i) {
+                    values.push_back(static_cast<std::int64_t>(((i / 500) * 2654435761) ^ 0x5bd1e995));
+                }
+
+                for (std::size_t w : widths) {
+                    EncodingPlan plan = roundtrip(values, w);
+                    if (w > 1) {
+                        AssertThat(plan.header.encoding == Encoding::RunLength, IsTrue());
+                    }
+                }
+            });
+
+            it("keeps random data raw", [&](){
+                std::vector<std::int64_t> values;
+                std::uint64_t x = 88172645463325252;
+                for (std::size_t i = 0; i < 5000; ++i) {
+                    x ^= x << 13;
+                    x ^= x >> 7;
+                    x ^= x << 17;
+                    values.push_back(static_cast<std::int64_t>(x));
+                }
+
+                for (std::size_t w : widths) {
+                    EncodingPlan plan = roundtrip(values, w);
+                    AssertThat(plan.header.encoding == Encoding::Raw, IsTrue());
+                }
+            });
+
+            it("stores other sizes raw", [](){
+                std::vector<char> values(3 * 100, 'x');
+                EncodingPlan plan = planEncoding(values.data(), 100, 3);
+                AssertThat(plan.header.encoding == Encoding::Raw, IsTrue());
+                AssertThat(plan.bytes, Equals(sizeof(SegmentHeader) + 300));
+            });
+        });
     });
 }
 